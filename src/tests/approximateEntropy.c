@@ -59,7 +59,7 @@ static const enum test test_num = TEST_APEN;	// This test number
 /*
  * Forward static function declarations
  */
-static double compute_phi(struct thread_state *thread_state, long int blocksize);
+static double compute_phi(struct thread_state *thread_state, long int blocksize, long int *C);
 static bool ApproximateEntropy_print_stat(FILE * stream, struct state *state, struct ApproximateEntropy_private_stats *stat,
 					  double p_value);
 static bool ApproximateEntropy_print_p_value(FILE * stream, double p_value);
@@ -80,7 +80,6 @@ void
 ApproximateEntropy_init(struct state *state)
 {
 	long int m;		// Approximate Entropy Test - block lengt
-	long int i;
 
 	/*
 	 * Check preconditions (firewall)
@@ -128,22 +127,12 @@ ApproximateEntropy_init(struct state *state)
 		err(10, __func__, "m is too large, 1 << (m:%ld) can't be longer than %ld bits", m, BITS_N_LONGINT - 1);
 	}
 	state->apen_C_len = (long int) 1 << (m + 1);
+	state->patternWidth = MAX(state->patternWidth, m + 1);	// Overlapping patterns to be counted for each iteration
 
 	/*
-	 * Allocate the array for the frequency count for each thread
+	 * Reserve the frequency count array in the scratch arena of each thread
 	 */
-	state->apen_C = malloc((size_t) state->numberOfThreads * sizeof(*state->apen_C));
-	if (state->apen_C == NULL) {
-		errp(10, __func__, "cannot malloc for apen_C: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->apen_C));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->apen_C[i] = malloc(state->apen_C_len * sizeof(state->apen_C[i][0]));
-		if (state->apen_C[i] == NULL) {
-			errp(10, __func__, "cannot malloc of %ld elements of %ld bytes each for state->apen_C[%ld]",
-			     state->apen_C_len, sizeof(state->apen_C[i][0]), i);
-		}
-	}
+	reserveScratch(state, (size_t) state->apen_C_len * sizeof(long int));
 
 	/*
 	 * Allocate dynamic arrays
@@ -184,6 +173,8 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
 	long int m;					// Approximate Entropy Test - block length
 	long int n;					// Length of a single bit stream
 	double p_value;					// p_value iteration test result(s)
+	long int *C;					// Frequency counts of the sub-sequences
+	struct result_shard *shard;			// Where this thread records the ApEn counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -195,6 +186,10 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(11, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(11, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
@@ -211,10 +206,11 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
 	n = state->tp.n;
 
 	/*
-	 * Step 4 and 5: compute phi for blocksize m and m+1
+	 * Step 4 and 5: compute phi for blocksize m and m+1, counting into C taken from the scratch arena of this thread
 	 */
-	stat.phi[0] = compute_phi(thread_state, m);
-	stat.phi[1] = compute_phi(thread_state, m + 1);
+	C = scratchAlloc(thread_state, (size_t) state->apen_C_len * sizeof(C[0]));
+	stat.phi[0] = compute_phi(thread_state, m, C);
+	stat.phi[1] = compute_phi(thread_state, m + 1, C);
 
 	/*
 	 * Step 6: compute the test statistic
@@ -227,35 +223,28 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
 	 */
 	p_value = cephes_igamc((double) ((long int) 1 << (m - 1)), stat.chi_squared / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -263,16 +252,9 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
@@ -284,17 +266,16 @@ ApproximateEntropy_iterate(struct thread_state *thread_state)
  * given:
  *      state           // run state to test under
  *      blocksize	// length of an overlapping sub-sequence
+ *      C               // state->apen_C_len frequency counters
  *
  * This auxiliary function computes the phi values needed for the
  * test statistic of the ApproximateEntropy test.
  */
 static double
-compute_phi(struct thread_state *thread_state, long int blocksize)
+compute_phi(struct thread_state *thread_state, long int blocksize, long int *C)
 {
 	long int n;		// Length of a single bit stream
 	long int powLen;	// Number of possible m-bit sub-sequences
-	long int mask;		// Bit-mask used to discard the extra bits of a sequence
-	long int dec;		// Decimal representation of an m-bit sub-sequence
 	double sum;		// Sum of the squares of all the counters, needed to compute psi-squared
 	long int i;
 
@@ -308,23 +289,14 @@ compute_phi(struct thread_state *thread_state, long int blocksize)
 	if (state == NULL) {
 		err(18, __func__, "state arg is NULL");
 	}
-	if (state->epsilon == NULL) {
-		err(18, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(18, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
-	}
 	if (blocksize == 0) {
 		return 0.0;
 	}
 	if (blocksize > (BITS_N_LONGINT - 1)) {	// firewall
 		err(18, __func__, "m is too large, 1 << (m:%ld) can't be longer than %ld bits", blocksize, BITS_N_LONGINT - 1);
 	}
-	if (state->apen_C == NULL) {
-		err(18, __func__, "state->apen_C is NULL");
-	}
-	if (state->apen_C[thread_state->thread_id] == NULL) {
-		err(18, __func__, "state->apen_C[%ld] is NULL", thread_state->thread_id);
+	if (C == NULL) {
+		err(18, __func__, "C arg is NULL");
 	}
 
 	/*
@@ -342,62 +314,23 @@ compute_phi(struct thread_state *thread_state, long int blocksize)
 				"1 << blockSize: %ld > state->apen_C_len: %ld ", powLen, blocksize, state->apen_C_len);
 	}
 
-	/*
-	 * Zeroize those counters in the array C
-	 */
-	memset(state->apen_C[thread_state->thread_id], 0, powLen * sizeof(state->apen_C[thread_state->thread_id][0]));
-
-	/*
-	 * Compute the mask that will be used by the algorithm
-	 */
-	mask = (1 << blocksize) - 1;
-
 	/*
 	 * Step 2: compute the frequency of all the overlapping sub-sequences
 	 *
-	 * This algorithm works by taking each consecutive overlapping sub-sequence
-	 * of length blocksize from the original sequence epsilon of length n.
-	 *
-	 * For each sub-sequence found, the decimal representation is computed and
-	 * the corresponding counter in the array v is incremented.
-	 *
-	 * It is convenient to use the decimal representation because we can more easily
-	 * store and have access to the counters of each block in the array v with size 2^blocksize.
-	 *
-	 * NOTE: i % n is used to avoid appending blocksize-1 bits in the end (as indicated in the paper)
+	 * The counts of the n overlapping sub-sequences of length blocksize, where the sub-sequences at the end
+	 * of epsilon wrap around to its start (as indicated in the paper), are stored in the array C indexed by
+	 * their decimal representation.  The sub-sequences are counted once per iteration and shared with the
+	 * other block size of this test and with the Serial test.
 	 */
-	for (dec = 0, i = 0; i < n + blocksize; i++) {
-
-		/*
-		 * Get the decimal representation of the current block.
-		 * This line of code works by shifting the decimal representation of the
-		 * previous number left by 1 bit, adding to it the following bit of epsilon,
-		 * and then discarding the left-most bit by doing an AND with the mask (in fact,
-		 * the mask is used to keep only the right-most blocksize bits of the number).
-		 */
-		dec = ((dec << 1) + (int) state->epsilon[thread_state->thread_id][i % n]) & mask;
-
-		/*
-		 * If we have already counted the first (blocksize - 1) bits of epsilon,
-		 * count the occurrence of the current block in its corresponding counter.
-		 *
-		 * NOTE: this check is important because during the first (blocksize - 1) iterations
-		 * of this loop, dec will be the decimal representation of blocks of length
-		 * which is smaller than blocksize.
-		 */
-		if (i >= blocksize) {
-			state->apen_C[thread_state->thread_id][dec]++;
-		}
-	}
+	getPatternCounts(state, thread_state->thread_id, blocksize, C);
 
 	/*
 	 * Step 3 and 4a: compute the the terms of the phi formula
 	 */
 	sum = 0.0;
 	for (i = 0; i < powLen; i++) {
-		if (state->apen_C[thread_state->thread_id][i]) {
-			sum += (double) state->apen_C[thread_state->thread_id][i] *
-					log(state->apen_C[thread_state->thread_id][i] / (double) n);
+		if (C[i]) {
+			sum += (double) C[i] * log(C[i] / (double) n);
 		}
 	}
 
@@ -1082,8 +1015,6 @@ ApproximateEntropy_metrics(struct state *state)
 void
 ApproximateEntropy_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1120,16 +1051,6 @@ ApproximateEntropy_destroy(struct state *state)
 		free(state->subDir[test_num]);
 		state->subDir[test_num] = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->apen_C[i] != NULL) {
-			free(state->apen_C[i]);
-			state->apen_C[i] = NULL;
-		}
-	}
-	if (state->apen_C != NULL) {
-		free(state->apen_C);
-		state->apen_C = NULL;
-	}
 
 	return;
 }
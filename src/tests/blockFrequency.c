@@ -181,7 +181,7 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	double pi;              // Proportion of ones in a block
 	double v;               // Value used in chi squared formula
 	long int i;
-	long int j;
+	struct result_shard *shard;	// Where this thread records the Block Frequency counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -193,15 +193,19 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(21, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(21, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(21, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(21, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(21, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(21, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 
 	/*
@@ -220,12 +224,7 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 		/*
 		 * Step 2: determine the proportion of ones in each M-bit block
 		 */
-		blockSum = 0;
-		for (j = 0; j < M; j++) {
-			if (state->epsilon[thread_state->thread_id][j + i * M]) {
-				blockSum++;
-			}
-		}
+		blockSum = packedPopcount(state->packedEpsilon[thread_state->thread_id], i * M, M);
 		pi = (double) blockSum / (double) M;
 
 		/*
@@ -245,35 +244,28 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	 */
 	p_value = cephes_igamc(N / 2.0, stat.chi_squared / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;	        // FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;	        // FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;	        // FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;	        // SUCCESS
 	}
 
@@ -281,16 +273,9 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
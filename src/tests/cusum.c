@@ -162,13 +162,13 @@ void
 CumulativeSums_iterate(struct thread_state *thread_state)
 {
 	struct CumulativeSums_private_stats stat;	// Stats for this iteration
-	long int n;			// Length of a single bit stream
-	long int S;			// Variable used to store the forward partial sums
+	struct walk *walk;		// Random walk of the forward partial sums
+	long int S;			// Final forward partial sum
 	long int S_max;			// Maximum forward partial sum
 	long int S_min;			// Minimum forward partial sum
 	double p_value_forward;		// p_value for forward test
 	double p_value_backward;	// p_value for backward test
-	long int k;
+	struct result_shard *shard;	// Where this thread records the forward and backward p_values and their counts
 
 	/*
 	 * Check preconditions (firewall)
@@ -180,26 +180,25 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(31, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(31, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(31, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(31, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(31, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(31, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->cSetup != true) {
 		err(31, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
 	}
 
-	/*
-	 * Collect parameters from state
-	 */
-	n = state->tp.n;
-
 	/*
 	 * Zeroize stats before performing the test
 	 */
@@ -216,15 +215,13 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	 * partial sums and S is the final total sum of the adjusted values of epsilon,
 	 * the maximum and the minimum backwards partial sums will be respectively
 	 * (S - S_min) and (S - S_max).
+	 *
+	 * The forward partial sums form the random walk of this iteration, which is shared with other tests.
 	 */
-	S = 0;
-	S_max = 0;
-	S_min = 0;
-	for (k = 0; k < n; k++) {
-		(state->epsilon[thread_state->thread_id][k] != 0) ? S++ : S--;
-		S_max = MAX(S, S_max);
-		S_min = MIN(S, S_min);
-	}
+	walk = getWalk(state, thread_state->thread_id);
+	S = walk->final;
+	S_max = walk->max;
+	S_min = walk->min;
 
 	/*
 	 * Step 3: compute the test statistics
@@ -240,60 +237,53 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	p_value_forward = compute_pi_value(state, stat.z_forward);
 	p_value_backward = compute_pi_value(state, stat.z_backward);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration (forward test)
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value_forward)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success_forward = false;	// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value_forward);
 	} else if (isGreaterThanOne(p_value_forward)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success_forward = false;	// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value_forward);
 	} else if (p_value_forward < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success_forward = false;	// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success_forward = true;	// SUCCESS
 	}
 
 	/*
 	 * Record success or failure for this iteration (backward test)
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value_backward)) {
-		state->failure[test_num]++;	// Bogus backward p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus backward p_value < 0.0 treated as a failure
 		stat.success_backward = false;	// FAILURE
 		warn(__func__, "iteration %ld of backward test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value_backward);
 	} else if (isGreaterThanOne(p_value_backward)) {
-		state->failure[test_num]++;	// Bogus backward p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus backward p_value > 1.0 treated as a failure
 		stat.success_backward = false;	// FAILURE
 		warn(__func__, "iteration %ld of backward test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value_backward);
 	} else if (p_value_backward < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid backward p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid backward p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid backward p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid backward p_value but too low is a failure
 		stat.success_backward = false;	// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid backward p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid backward p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid backward p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid backward p_value not too low is a success
 		stat.success_backward = true;	// SUCCESS
 	}
 
@@ -301,17 +291,10 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value_forward);
-	append_value(state->p_val[test_num], &p_value_backward);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value_forward);
+	append_value(shard->p_val[test_num], &p_value_backward);
 
 	return;
 }
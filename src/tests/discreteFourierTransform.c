@@ -69,6 +69,7 @@ static const enum test test_num = TEST_DFT;	// This test number
  */
 static double sqrtn4_095_005;			// Square root of (n / 4.0 * 0.95 * 0.05)
 static double sqrt_log20_n;			// Square root of ln(20) * n
+static double peak_threshold2;			// Smallest squared modulus whose square root is >= sqrt_log20_n
 
 
 /*
@@ -94,7 +95,11 @@ void
 DiscreteFourierTransform_init(struct state *state)
 {
 	long int n;		// Length of a single bit stream
-	long int i;
+#if !defined(LEGACY_FFT)
+	unsigned int plan_flags;	// Rigor with which the fftw library plans the DFT
+	double *X;		// Input array the DFT is planned on
+	fftw_complex *out;	// Output array the DFT is planned on
+#endif /* LEGACY_FFT */
 
 	/*
 	 * Check preconditions (firewall)
@@ -142,64 +147,106 @@ DiscreteFourierTransform_init(struct state *state)
 	sqrt_log20_n = sqrt(log(20.0) * (double) state->tp.n);	// 2.995732274 * n
 
 	/*
-	 * Allocate arrays that will be used by the DFT libraries, for each thread
+	 * Peaks are counted from their squared modulus, so find the smallest squared modulus x such that sqrt(x)
+	 * is not below sqrt_log20_n.  As sqrt() is monotonic, x < peak_threshold2 exactly when sqrt(x) < sqrt_log20_n.
 	 */
-	state->fft_X = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_X));
-	if (state->fft_X == NULL) {
-		errp(40, __func__, "cannot malloc for fft_X: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_X));
+	peak_threshold2 = sqrt_log20_n * sqrt_log20_n;
+	while (sqrt(peak_threshold2) >= sqrt_log20_n) {
+		peak_threshold2 = nextafter(peak_threshold2, 0.0);
 	}
-#if defined(LEGACY_FFT)
-	state->fft_wsave = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_wsave));
-	if (state->fft_wsave == NULL) {
-		errp(40, __func__, "cannot malloc for fft_wsave: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_wsave));
+	while (sqrt(peak_threshold2) < sqrt_log20_n) {
+		peak_threshold2 = nextafter(peak_threshold2, HUGE_VAL);
 	}
+
+	/*
+	 * Reserve the arrays used by the DFT libraries in the scratch arena of each thread:
+	 * X, followed by wsave (legacy dfft) or by the n / 2 + 1 complex values of the fftw output
+	 */
+	reserveScratch(state, (size_t) n * sizeof(double));
+#if defined(LEGACY_FFT)
+	reserveScratch(state, (size_t) 2 * n * sizeof(double));
 #else /* LEGACY_FFT */
-	state->fftw_out = malloc((size_t) state->numberOfThreads * sizeof(*state->fftw_out));
-	if (state->fftw_out == NULL) {
-		errp(40, __func__, "cannot malloc for fftw_out: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fftw_out));
-	}
-	state->fftw_p = malloc((size_t) state->numberOfThreads * sizeof(*state->fftw_p));
-	if (state->fftw_p == NULL) {
-		errp(40, __func__, "cannot malloc for fftw_p: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fftw_p));
-	}
-#endif /* LEGACY_FFT */
-	state->fft_m = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_m));
-	if (state->fft_m == NULL) {
-		errp(40, __func__, "cannot malloc for fft_m: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_m));
-	}
+	reserveScratch(state, (size_t) (n / 2 + 1) * sizeof(fftw_complex));
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->fft_X[i] = calloc((size_t) state->tp.n, sizeof(state->fft_X[i][0]));
-		if (state->fft_X[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_X[%ld]",
-			     n, sizeof(state->fft_X[i][0]), i);
+	/*
+	 * When there are fewer tasks than cores, the cores left over by the tasks help the fftw library.
+	 * The fftw threads must be setup before any wisdom is imported.
+	 */
+	if (state->fftwThreads > 1) {
+		if (fftw_init_threads() == 0) {
+			err(40, __func__, "fftw_init_threads failed");
 		}
-#if defined(LEGACY_FFT)
-		state->fft_wsave[i] = calloc((size_t) 2 * state->tp.n, sizeof(state->fft_wsave[i][0]));
-		if (state->fft_wsave[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_wsave[%ld]",
-			     2 * n, sizeof(state->fft_wsave[i][0]), i);
+		fftw_plan_with_nthreads((int) state->fftwThreads);
+		dbg(DBG_LOW, "each DFT will be computed by %ld fftw threads", state->fftwThreads);
+	}
+
+	/*
+	 * With -W wisdom[,rigor], import the wisdom of earlier runs and plan with the given rigor.  A plan already
+	 * held by the wisdom is not measured again, so only the first measuring run for a given n pays for it.
+	 */
+	plan_flags = FFTW_ESTIMATE;
+	if (state->wisdomFlag == true) {
+		if (state->wisdomPath[0] == '/') {
+			state->wisdomFilename = malloc(strlen(state->wisdomPath) + 1);
+			if (state->wisdomFilename == NULL) {
+				errp(40, __func__, "cannot malloc of %lu bytes for wisdomFilename", strlen(state->wisdomPath) + 1);
+			}
+			strcpy(state->wisdomFilename, state->wisdomPath);
+		} else {
+			state->wisdomFilename = filePathName(state->workDir, state->wisdomPath);
 		}
-#else /* LEGACY_FFT */
-		state->fftw_out[i] = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (n / 2 + 1));
-		if (state->fftw_out[i] == NULL) {
-			errp(40, __func__, "cannot fftw_malloc of %ld elements of %ld bytes each for state->fftw_out[%ld]",
-			     n / 2 + 1, sizeof(fftw_complex), i);
+		switch (state->wisdomRigor) {
+		case PLAN_ESTIMATE:
+			plan_flags = FFTW_ESTIMATE;
+			break;
+		case PLAN_MEASURE:
+			plan_flags = FFTW_MEASURE;
+			break;
+		case PLAN_PATIENT:
+			plan_flags = FFTW_PATIENT;
+			break;
+		default:
+			err(40, __func__, "unknown wisdomRigor: %c", state->wisdomRigor);
+			break;
 		}
-		state->fftw_p[i] = fftw_plan_dft_r2c_1d((int) n, state->fft_X[i], state->fftw_out[i], FFTW_ESTIMATE);
-#endif /* LEGACY_FFT */
-		state->fft_m[i] = calloc((size_t) (n / 2 + 1), sizeof(state->fft_m[i][0]));
-		if (state->fft_m[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_m[%ld]",
-			     n / 2 + 1, sizeof(state->fft_m[i][0]), i);
+		if (fftw_import_wisdom_from_filename(state->wisdomFilename) != 0) {
+			dbg(DBG_LOW, "imported FFTW wisdom from: %s", state->wisdomFilename);
+		} else {
+			dbg(DBG_LOW, "no FFTW wisdom imported from: %s, first plan for n: %ld will be made with rigor: %c",
+			    state->wisdomFilename, n, state->wisdomRigor);
 		}
 	}
 
+	/*
+	 * Plan the DFT once, on temporary arrays, for all threads
+	 *
+	 * NOTE: The planned arrays are only used to find the plan, as planning with more rigor than FFTW_ESTIMATE
+	 *	 overwrites them.  Each iteration runs the plan on the arrays it takes from the scratch arena with
+	 *	 fftw_execute_dft_r2c(), whose SCRATCH_ALIGN aligned chunks meet the alignment of fftw_malloc().
+	 *	 As fftw_execute_dft_r2c() may be called on the same plan by several threads at once, a single
+	 *	 plan is made, so that only one plan is measured under -W wisdom,m or -W wisdom,p.
+	 *
+	 * NOTE: A batched fftw_plan_many_dft_r2c() plan is not used.  Although the task graph keeps up to
+	 *	 2 * numberOfThreads iterations loaded, batching them would have one thread transform the
+	 *	 iterations that the other threads now transform in parallel, and measured on its own, a batch
+	 *	 of 2 or 8 transforms of 20000 to 1048576 bits is no faster per transform than single plans.
+	 */
+	X = fftw_malloc(sizeof(X[0]) * (size_t) n);
+	if (X == NULL) {
+		errp(40, __func__, "cannot fftw_malloc of %ld elements of %ld bytes each for X", n, sizeof(X[0]));
+	}
+	out = fftw_malloc(sizeof(out[0]) * (size_t) (n / 2 + 1));
+	if (out == NULL) {
+		errp(40, __func__, "cannot fftw_malloc of %ld elements of %ld bytes each for out", n / 2 + 1, sizeof(out[0]));
+	}
+	state->fftw_p = fftw_plan_dft_r2c_1d((int) n, X, out, plan_flags);
+	if (state->fftw_p == NULL) {
+		err(40, __func__, "cannot plan the DFT of %ld bits", n);
+	}
+	fftw_free(X);
+	fftw_free(out);
+#endif /* LEGACY_FFT */
+
 	/*
 	 * Allocate dynamic arrays
 	 */
@@ -239,7 +286,7 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	long int n;			// Length of a single bit stream
 	double p_value;			// p_value iteration test result(s)
 	double *X = NULL;		// Adjusted sequence with +1 and -1 bits
-	double *m = NULL;		// Magnitude of the DFT
+	WORD64 *packed;			// Packed bit stream of this thread
 	long int i;
 #if defined(LEGACY_FFT)
 	double *wsave = NULL;		// Work array used by __ogg_fdrffti() and __ogg_fdrfftf()
@@ -248,6 +295,7 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	fftw_complex *out;		// Output of the DFT
 	fftw_plan p;			// Information on the fastest way to compute the DFT on this machine
 #endif /* LEGACY_FFT */
+	struct result_shard *shard;	// Where this thread records the DFT counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -259,78 +307,54 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(41, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(41, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(41, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->fft_X == NULL) {
-		err(41, __func__, "state->fft_X is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(41, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->fft_X[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fft_X[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->fft_m == NULL) {
-		err(41, __func__, "state->fft_m is NULL");
-	}
-	if (state->fft_m[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fft_m[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(41, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->cSetup != true) {
 		err(41, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
 	}
-#if defined(LEGACY_FFT)
-	if (state->fft_wsave == NULL) {
-		err(41, __func__, "state->fft_wsave is NULL");
-	}
-	if (state->fft_wsave[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fft_wsave[%ld] is NULL", thread_state->thread_id);
-	}
-#else
-	if (state->fftw_out == NULL) {
-		err(41, __func__, "state->fftw_out is NULL");
-	}
-	if (state->fftw_out[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fftw_out[%ld] is NULL", thread_state->thread_id);
-	}
+#if !defined(LEGACY_FFT)
 	if (state->fftw_p == NULL) {
 		err(41, __func__, "state->fftw_p is NULL");
 	}
-	if (state->fftw_p[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fftw_p[%ld] is NULL", thread_state->thread_id);
-	}
 #endif /* LEGACY_FFT */
 
 	/*
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
-	X = state->fft_X[thread_state->thread_id];
+	packed = state->packedEpsilon[thread_state->thread_id];
+#if !defined(LEGACY_FFT)
+	p = state->fftw_p;
+#endif /* LEGACY_FFT */
+
+	/*
+	 * Take the arrays of the DFT libraries from the scratch arena of this thread
+	 */
+	X = scratchAlloc(thread_state, (size_t) n * sizeof(X[0]));
 #if defined(LEGACY_FFT)
-	wsave = state->fft_wsave[thread_state->thread_id];
+	wsave = scratchAlloc(thread_state, (size_t) 2 * n * sizeof(wsave[0]));
 #else /* LEGACY_FFT */
-	out = state->fftw_out[thread_state->thread_id];
-	p = state->fftw_p[thread_state->thread_id];
+	out = scratchAlloc(thread_state, (size_t) (n / 2 + 1) * sizeof(out[0]));
 #endif /* LEGACY_FFT */
-	m = state->fft_m[thread_state->thread_id];
 
 	/*
 	 * Step 1: initialize X for this iteration
 	 */
 	for (i = 0; i < n; i++) {
-		if ((int) state->epsilon[thread_state->thread_id][i] == 1) {
-			X[i] = 1;
-		} else if ((int) state->epsilon[thread_state->thread_id][i] == 0) {
-			X[i] = -1;
-		} else {
-			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-		}
+		X[i] = (packedBit(packed, i) != 0) ? 1.0 : -1.0;
 	}
 
 	/*
@@ -358,57 +382,47 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	 * As a consequence, the computed complex frequencies will be saved in the out array
 	 * of size n / 2 + 1.
 	 */
-	fftw_execute(p);
+	fftw_execute_dft_r2c(p, X, out);
 #endif /* LEGACY_FFT */
 
-#if defined(LEGACY_FFT)
-	/*
-	 * Step 3a: compute modulus (absolute value) of the first element of the DFT output.
-	 * This first element is always real, and has no imaginary part.
-	 */
-	m[0] = fabs(X[0]);
-
 	/*
-	 * Step 3b: compute the modulus of the following n/2 elements of the DFT output.
-	 * These elements are always complex, so we have to consider both real and imaginary value.
+	 * Step 5: compute N0
+	 * NOTE: Step 4 is skipped because T has already been computed
 	 */
-	long int j;
-	for (i = 0, j = 1; i < n - 1; i += 2, j++) {
-		m[j] = sqrt((X[i] * X[i]) + (X[i + 1] * X[i + 1]));
-	}
+	stat.N_0 = (double) 0.95 * n / 2.0;
 
 	/*
-	 * Step 3c: if n is even, consider the remaining additional element at the end of the DFT output.
-	 * This last element is always real, and has no imaginary part.
+	 * Step 3 and Step 6: compute N1, the number of the first n/2 elements of the DFT output whose
+	 * modulus (absolute value) is less than T.
+	 *
+	 * The moduli are not stored.  Each one is compared to T as it is found, through its square
+	 * against peak_threshold2, which gives the same count as comparing its square root against T.
 	 */
-	if ((n % 2) == 0) {
-		m[i+1] = fabs(X[n-1]);
-	}
-#else /* LEGACY_FFT */
+	stat.N_1 = 0;
+#if defined(LEGACY_FFT)
 	/*
-	 * Step 3: compute modulus (absolute value) of the first (n / 2 + 1) elements (in our case
-	 * all the ones that we have) of the DFT output.
+	 * The first element of the DFT output is always real, and has no imaginary part.
 	 */
-	for (i = 0; i < n / 2 + 1; i++) {
-		m[i] = cabs(out[i]);
+	if (fabs(X[0]) < sqrt_log20_n) {
+		stat.N_1++;
 	}
-#endif /* LEGACY_FFT */
 
 	/*
-	 * Step 5: compute N0
-	 * NOTE: Step 4 is skipped because T has already been computed
+	 * The following elements are complex, so we have to consider both real and imaginary value.
+	 * Element j is formed from X[2 * j - 2] and X[2 * j - 1], as the legacy code has always done.
 	 */
-	stat.N_0 = (double) 0.95 * n / 2.0;
-
-	/*
-	 * Step 6: compute N1
-	 */
-	stat.N_1 = 0;
+	for (i = 1; i < n / 2; i++) {
+		if ((X[2 * i - 2] * X[2 * i - 2]) + (X[2 * i - 1] * X[2 * i - 1]) < peak_threshold2) {
+			stat.N_1++;
+		}
+	}
+#else /* LEGACY_FFT */
 	for (i = 0; i < n / 2; i++) {
-		if (m[i] < sqrt_log20_n) {
+		if ((creal(out[i]) * creal(out[i])) + (cimag(out[i]) * cimag(out[i])) < peak_threshold2) {
 			stat.N_1++;
 		}
 	}
+#endif /* LEGACY_FFT */
 
 	/*
 	 * Step 7: compute the test statistic
@@ -420,35 +434,28 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	 */
 	p_value = erfc(fabs(stat.d) / state->c.sqrt2);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -456,16 +463,9 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
@@ -1134,8 +1134,6 @@ DiscreteFourierTransform_metrics(struct state *state)
 void
 DiscreteFourierTransform_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1161,6 +1159,19 @@ DiscreteFourierTransform_destroy(struct state *state)
 		state->p_val[test_num] = NULL;
 	}
 
+	/*
+	 * Save the wisdom gathered while planning for the next run with -W wisdom
+	 */
+#if !defined(LEGACY_FFT)
+	if (state->wisdomFilename != NULL) {
+		if (fftw_export_wisdom_to_filename(state->wisdomFilename) != 0) {
+			dbg(DBG_LOW, "exported FFTW wisdom to: %s", state->wisdomFilename);
+		} else {
+			warn(__func__, "cannot export FFTW wisdom to: %s", state->wisdomFilename);
+		}
+	}
+#endif /* LEGACY_FFT */
+
 	/*
 	 * Free other test storage
 	 */
@@ -1174,55 +1185,19 @@ DiscreteFourierTransform_destroy(struct state *state)
 	}
 
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->fft_X[i] != NULL) {
-			free(state->fft_X[i]);
-			state->fft_X[i] = NULL;
-		}
-#if defined(LEGACY_FFT)
-		if (state->fft_wsave[i] != NULL) {
-			free(state->fft_wsave[i]);
-			state->fft_wsave[i] = NULL;
-		}
-#else /* LEGACY_FFT */
-		if (state->fftw_out[i] != NULL) {
-			fftw_free(state->fftw_out[i]);
-			state->fftw_out[i] = NULL;
-		}
-		if (state->fftw_p[i] != NULL) {
-			fftw_destroy_plan(state->fftw_p[i]);
-			state->fftw_p[i] = NULL;
-		}
-#endif /* LEGACY_FFT */
-		if (state->fft_m[i] != NULL) {
-			free(state->fft_m[i]);
-			state->fft_m[i] = NULL;
-		}
-	}
-
-	if (state->fft_X != NULL) {
-		free(state->fft_X);
-		state->fft_X = NULL;
-	}
-#if defined(LEGACY_FFT)
-	if (state->fft_wsave != NULL) {
-		free(state->fft_wsave);
-		state->fft_wsave = NULL;
-	}
-#else /* LEGACY_FFT */
-	if (state->fftw_out != NULL) {
-		free(state->fftw_out);
-		state->fftw_out = NULL;
-	}
+#if !defined(LEGACY_FFT)
 	if (state->fftw_p != NULL) {
-		free(state->fftw_p);
+		fftw_destroy_plan(state->fftw_p);
 		state->fftw_p = NULL;
 	}
-#endif /* LEGACY_FFT */
-	if (state->fft_m != NULL) {
-		free(state->fft_m);
-		state->fft_m = NULL;
+
+	/*
+	 * Release the fftw threads once the plan that used them is gone
+	 */
+	if (state->fftwThreads > 1) {
+		fftw_cleanup_threads();
 	}
+#endif /* LEGACY_FFT */
 
 	return;
 }
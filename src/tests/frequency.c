@@ -154,7 +154,7 @@ Frequency_iterate(struct thread_state *thread_state)
 	double f;		// Term in the p-value formula
 	double s_obs;		// Test statistic
 	double p_value;		// p_value iteration test result(s)
-	long int i;
+	struct result_shard *shard;	// Where this thread records the Frequency counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -166,16 +166,20 @@ Frequency_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(71, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(71, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate driver interface for %s[%d] called when test vector was false", state->testNames[test_num],
 		    test_num);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(71, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(71, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(71, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(71, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->cSetup != true) {
 		err(71, __func__, "test constants not setup prior to calling %s for %s[%d]",
@@ -189,17 +193,10 @@ Frequency_iterate(struct thread_state *thread_state)
 
 	/*
 	 * Step 1: compute S_n
+	 *
+	 * Each 1 bit adds 1 and each 0 bit subtracts 1, so S_n is twice the number of 1 bits minus n.
 	 */
-	stat.S_n = 0;
-	for (i = 0; i < n; i++) {
-		if ((int) state->epsilon[thread_state->thread_id][i] == 1) {
-			stat.S_n++;
-		} else if ((int) state->epsilon[thread_state->thread_id][i] == 0) {
-			stat.S_n--;
-		} else {
-			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-		}
-	}
+	stat.S_n = 2 * packedPopcount(state->packedEpsilon[thread_state->thread_id], 0, n) - n;
 
 	/*
 	 * Step 2: compute the test statistic
@@ -212,35 +209,28 @@ Frequency_iterate(struct thread_state *thread_state)
 	f = s_obs / state->c.sqrt2;
 	p_value = erfc(f);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;	        // FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;	        // FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;	        // FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;	        // SUCCESS
 	}
 
@@ -248,16 +238,9 @@ Frequency_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
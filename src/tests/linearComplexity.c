@@ -69,6 +69,7 @@ static bool LinearComplexity_print_stat(FILE * stream, struct state *state, stru
 					double p_value);
 static bool LinearComplexity_print_p_value(FILE * stream, double p_value);
 static void LinearComplexity_metric_print(struct state *state, long int sampleCount, long int toolow, long int *freqPerBin);
+static void LinearComplexity_blocks(struct block_range *range);
 
 
 /*
@@ -87,6 +88,7 @@ LinearComplexity_init(struct state *state)
 	long int n;		// Length of a single bit stream
 	long int M;		// Length of each block to be tested
 	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
+	long int words;		// Number of words holding a packed LFSR polynomial of degree <= M
 	long int i;
 
 	/*
@@ -146,39 +148,36 @@ LinearComplexity_init(struct state *state)
 	}
 
 	/*
-	 * Allocate special Linear Feedback Shift Register arrays for each thread
+	 * Allocate the slots of special Linear Feedback Shift Register arrays for each thread and each of its block threads
+	 *
+	 * Each array holds a polynomial of degree <= M, packed with coefficient k as bit (k % BITS_N_WORD64)
+	 * of word k / BITS_N_WORD64.  The arrays themselves are taken by each iteration from the scratch arena
+	 * of its thread, one b, c and t for each share of the blocks.
 	 */
-	state->linear_b = malloc((size_t) state->numberOfThreads * sizeof(*state->linear_b));
+	words = M / BITS_N_WORD64 + 1;
+	state->linear_b = calloc((size_t) state->numberOfThreads * state->blockThreads, sizeof(*state->linear_b));
 	if (state->linear_b == NULL) {
-		errp(100, __func__, "cannot malloc for linear_b: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->linear_b));
+		errp(100, __func__, "cannot calloc for linear_b: %ld elements of %lu bytes each",
+		     state->numberOfThreads * state->blockThreads, sizeof(*state->linear_b));
 	}
-	state->linear_c = malloc((size_t) state->numberOfThreads * sizeof(*state->linear_c));
+	state->linear_c = calloc((size_t) state->numberOfThreads * state->blockThreads, sizeof(*state->linear_c));
 	if (state->linear_c == NULL) {
-		errp(100, __func__, "cannot malloc for linear_c: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->linear_c));
+		errp(100, __func__, "cannot calloc for linear_c: %ld elements of %lu bytes each",
+		     state->numberOfThreads * state->blockThreads, sizeof(*state->linear_c));
 	}
-	state->linear_t = malloc((size_t) state->numberOfThreads * sizeof(*state->linear_t));
-	if (state->linear_b == NULL) {
-		errp(100, __func__, "cannot malloc for linear_t: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->linear_t));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->linear_b[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_b[i][0]));
-		if (state->linear_b[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_b[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_b[i][0]), i);
-		}
-		state->linear_c[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_c[i][0]));
-		if (state->linear_c[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_c[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_c[i][0]), i);
-		}
-		state->linear_t[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_t[i][0]));
-		if (state->linear_t[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_t[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_t[i][0]), i);
-		}
+	state->linear_t = calloc((size_t) state->numberOfThreads * state->blockThreads, sizeof(*state->linear_t));
+	if (state->linear_t == NULL) {
+		errp(100, __func__, "cannot calloc for linear_t: %ld elements of %lu bytes each",
+		     state->numberOfThreads * state->blockThreads, sizeof(*state->linear_t));
+	}
+
+	/*
+	 * Reserve the class counts and the b, c and t arrays of each share of an iteration in the scratch arena
+	 * of each thread
+	 */
+	reserveScratch(state, (size_t) state->blockThreads * sizeof(struct LinearComplexity_private_stats));
+	for (i = 0; i < 3 * state->blockThreads; i++) {
+		reserveScratch(state, (size_t) words * sizeof(WORD64));
 	}
 
 	/*
@@ -204,28 +203,32 @@ LinearComplexity_init(struct state *state)
 
 
 /*
- * LinearComplexity_iterate - iterate one bit stream for Linear Complexity test
+ * LinearComplexity_blocks - classify the linear complexity of each block of one share of an iteration
  *
  * given:
- *      state           // run state to test under
- *
- * This function is called for each and every iteration noted in state->tp.numOfBitStreams.
+ *      range           // share of the blocks to classify (see runBlocks())
  *
- * NOTE: The initialize function must be called first.
+ * The class counts are added to the v field of the struct LinearComplexity_private_stats at range->result.
  */
-void
-LinearComplexity_iterate(struct thread_state *thread_state)
+static void
+LinearComplexity_blocks(struct block_range *range)
 {
-	struct LinearComplexity_private_stats stat;	// Stats for this iteration
+	struct LinearComplexity_private_stats *stat;	// Class counts of this share
 	long int M;		// Length of each block to be tested
-	long int n;		// Length of a single bit stream
-	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
-	long int d;		// Discrepancy for LFSR algorithm
+	WORD64 *packed;		// Packed bit stream of this thread
+	WORD64 *b;		// Packed LFSR polynomial b
+	WORD64 *c;		// Packed LFSR polynomial c
+	WORD64 *t;		// Packed LFSR polynomial t, the copy of c made before c is updated
+	WORD64 *swap;		// Used to exchange b and t
+	WORD64 d;		// Discrepancy for LFSR algorithm, before its parity is taken
+	long int words;		// Number of words holding a packed LFSR polynomial of degree <= M
 	long int L;		// Length of the minimal LFSR for the stream
 	long int m;		// Number of iterations since L was updated to 1 for the LFSR algorithm
+	long int shift;		// Number of coefficients by which b is shifted when c is updated
+	long int start;		// Position of the first bit of the block in the sequence
+	int o;			// Number of bits by which b is shifted within a word when c is updated
 	double mean;		// Theoretical mean under an assumption of randomness
 	double T;		// Value used to identify the class v to increment
-	double p_value;		// p_value iteration test result(s)
 	double class;		// Boundary of the lowest v[i] given T[i]
 	long int i;
 	long int j;
@@ -234,69 +237,51 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	/*
 	 * Check preconditions (firewall)
 	 */
-	if (thread_state == NULL) {
-		err(101, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
-	if (state == NULL) {
-		err(101, __func__, "state arg is NULL");
-	}
-	if (state->testVector[test_num] != true) {
-		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
-		return;
-	}
-	if (state->epsilon == NULL) {
-		err(101, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(101, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (range == NULL) {
+		err(101, __func__, "range arg is NULL");
 	}
-	if (state->linear_b == NULL) {
-		err(101, __func__, "state->linear_b is NULL");
-	}
-	if (state->linear_b[thread_state->thread_id] == NULL) {
-		err(101, __func__, "state->linear_b[%ld] is NULL", thread_state->thread_id);
+	struct state *state = range->thread_state->global_state;
+	if (state->linear_b[range->slot] == NULL) {
+		err(101, __func__, "state->linear_b[%ld] is NULL", range->slot);
 	}
-	if (state->linear_c == NULL) {
-		err(101, __func__, "state->linear_c is NULL");
-	}
-	if (state->linear_c[thread_state->thread_id] == NULL) {
-		err(101, __func__, "state->linear_c[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->linear_t == NULL) {
-		err(101, __func__, "state->linear_t is NULL");
+	if (state->linear_c[range->slot] == NULL) {
+		err(101, __func__, "state->linear_c[%ld] is NULL", range->slot);
 	}
-	if (state->linear_t[thread_state->thread_id] == NULL) {
-		err(101, __func__, "state->linear_t[%ld] is NULL", thread_state->thread_id);
+	if (state->linear_t[range->slot] == NULL) {
+		err(101, __func__, "state->linear_t[%ld] is NULL", range->slot);
 	}
 
 	/*
 	 * Collect parameters from state
 	 */
+	stat = range->result;
 	M = state->tp.linearComplexitySequenceLength;
-	n = state->tp.n;
-	N = n / M;
-
-	/*
-	 * Zeroize the v counters
-	 */
-	memset(stat.v, 0, sizeof(stat.v));
+	words = M / BITS_N_WORD64 + 1;
+	packed = state->packedEpsilon[range->thread_state->thread_id];
+	b = state->linear_b[range->slot];
+	c = state->linear_c[range->slot];
+	t = state->linear_t[range->slot];
 
 	/*
-	 * Step 1: partition the sequence into N independent blocks
+	 * Step 1: partition the sequence into N independent blocks, of which this share has range->count
 	 *
 	 * Step 2: for each block, we will determine the linear complexity using the version of the Berlekamp-Massey
 	 * algorithm specialized for the binary finite field F2. Explanation of the sub-steps: https://goo.gl/Um0YUr
+	 *
+	 * NOTE: c, b and t are packed with coefficient k as bit (k % BITS_N_WORD64) of word k / BITS_N_WORD64.
+	 *	 A window of the sequence ending at bit j then holds bit j - k as its bit k, so the terms of the
+	 *	 discrepancy are the bits of c AND the window, a word at a time.
 	 */
-	for (i = 0; i < N; i++) {
+	for (i = range->first; i < range->first + range->count; i++) {
+		start = i * M;
 
 		/*
 		 * Sub-step 2: Zeroize the two arrays b and c and set b[0] and c[0] to 1
 		 */
-		memset(state->linear_b[thread_state->thread_id], 0, M * sizeof(state->linear_b[thread_state->thread_id][0]));
-		memset(state->linear_c[thread_state->thread_id], 0, M * sizeof(state->linear_c[thread_state->thread_id][0]));
-		state->linear_c[thread_state->thread_id][0] = 1;
-		state->linear_b[thread_state->thread_id][0] = 1;
+		memset(b, 0, words * sizeof(b[0]));
+		memset(c, 0, words * sizeof(c[0]));
+		c[0] = 1;
+		b[0] = 1;
 
 		/*
 		 * Sub-step 3: initialize L and m to their initial values
@@ -312,30 +297,39 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 
 			/*
 			 * Sub-step 4a: set the discrepancy
+			 *
+			 * The terms for k = 0 thru L are bits j - k of the sequence, only the last word of c
+			 * may hold fewer than BITS_N_WORD64 of them.
 			 */
-			d = (int) state->epsilon[thread_state->thread_id][i * M + j];
-			for (k = 1; k <= L; k++) {
-				d += state->linear_c[thread_state->thread_id][k] *
-						state->epsilon[thread_state->thread_id][i * M + j - k];
+			d = 0;
+			for (k = 0; k + BITS_N_WORD64 <= L + 1; k += BITS_N_WORD64) {
+				d ^= c[k / BITS_N_WORD64] & packedWindow(packed, start + j - k - (BITS_N_WORD64 - 1), BITS_N_WORD64);
+			}
+			if (k <= L) {
+				d ^= c[k / BITS_N_WORD64] & packedWindow(packed, start + j - L, (int) (L + 1 - k));
 			}
 
-			d = d % 2;
-			if (d == 1) {
+			if (__builtin_parityll(d) == 1) {
 
 				/*
 				 * Sub-step 4b: let t be a copy of c
+				 *
+				 * The copy is only needed when it will become b in sub-step 4d.
 				 */
-				memcpy(state->linear_t[thread_state->thread_id], state->linear_c[thread_state->thread_id],
-				       M * sizeof(state->linear_t[thread_state->thread_id][0]));
+				if (L <= j / 2) {
+					memcpy(t, c, words * sizeof(t[0]));
+				}
 
 				/*
-				 * Sub-step 4c: update c array
+				 * Sub-step 4c: update c array by adding b shifted up by j - m coefficients
 				 */
-				for (k = j - m; k < M; k++) {
-					state->linear_c[thread_state->thread_id][k] =
-							(BitSequence) ((state->linear_c[thread_state->thread_id][k] +
-									state->linear_b[thread_state->thread_id][k - j + m]) % 2);
+				shift = j - m;
+				o = (int) (shift % BITS_N_WORD64);
+				for (k = words - 1; k > shift / BITS_N_WORD64; k--) {
+					c[k] ^= (o == 0) ? b[k - shift / BITS_N_WORD64] :
+						(b[k - shift / BITS_N_WORD64] << o) | (b[k - shift / BITS_N_WORD64 - 1] >> (BITS_N_WORD64 - o));
 				}
+				c[k] ^= b[0] << o;
 
 				/*
 				 * Sub-step 4d: update L, M and b
@@ -343,8 +337,9 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 				if (L <= j / 2) {
 					L = j + 1 - L;
 					m = j;
-					memcpy(state->linear_b[thread_state->thread_id], state->linear_t[thread_state->thread_id],
-					       M * sizeof(state->linear_b[thread_state->thread_id][0]));
+					swap = b;
+					b = t;
+					t = swap;
 				}
 			}
 		}
@@ -369,11 +364,102 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 		 */
 		class = (double) (K_LINEARCOMPLEXITY - 1) / 2.0;
 		if (T <= - class) {
-			stat.v[0]++;
+			stat->v[0]++;
 		} else if (T > class) {
-			stat.v[K_LINEARCOMPLEXITY]++;
+			stat->v[K_LINEARCOMPLEXITY]++;
 		} else {
-			stat.v[(int) ceil(T + class)]++;
+			stat->v[(int) ceil(T + class)]++;
+		}
+	}
+}
+
+
+/*
+ * LinearComplexity_iterate - iterate one bit stream for Linear Complexity test
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function is called for each and every iteration noted in state->tp.numOfBitStreams.
+ *
+ * NOTE: The initialize function must be called first.
+ */
+void
+LinearComplexity_iterate(struct thread_state *thread_state)
+{
+	struct LinearComplexity_private_stats stat;	// Stats for this iteration
+	struct LinearComplexity_private_stats *share;	// Class counts of each share of the blocks
+	long int M;		// Length of each block to be tested
+	long int n;		// Length of a single bit stream
+	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
+	long int words;		// Number of words holding a packed LFSR polynomial of degree <= M
+	long int slot;		// Slot of the first share of this thread in the per share arrays
+	double p_value;		// p_value iteration test result(s)
+	long int i;
+	long int j;
+	struct result_shard *shard;	// Where this thread records the Linear Complexity counts, p_value and stats
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(101, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(101, __func__, "state arg is NULL");
+	}
+	if (state->shard == NULL) {
+		err(101, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
+	if (state->testVector[test_num] != true) {
+		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
+		return;
+	}
+	if (state->packedEpsilon == NULL) {
+		err(101, __func__, "state->packedEpsilon is NULL");
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(101, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	if (state->linear_b == NULL) {
+		err(101, __func__, "state->linear_b is NULL");
+	}
+	if (state->linear_c == NULL) {
+		err(101, __func__, "state->linear_c is NULL");
+	}
+	if (state->linear_t == NULL) {
+		err(101, __func__, "state->linear_t is NULL");
+	}
+
+	/*
+	 * Collect parameters from state
+	 */
+	M = state->tp.linearComplexitySequenceLength;
+	n = state->tp.n;
+	N = n / M;
+	words = M / BITS_N_WORD64 + 1;
+	slot = thread_state->thread_id * state->blockThreads;
+
+	/*
+	 * Take the class counts and the LFSR arrays of each share from the scratch arena of this thread
+	 */
+	share = scratchAlloc(thread_state, (size_t) state->blockThreads * sizeof(share[0]));
+	for (i = 0; i < state->blockThreads; i++) {
+		state->linear_b[slot + i] = scratchAlloc(thread_state, (size_t) words * sizeof(WORD64));
+		state->linear_c[slot + i] = scratchAlloc(thread_state, (size_t) words * sizeof(WORD64));
+		state->linear_t[slot + i] = scratchAlloc(thread_state, (size_t) words * sizeof(WORD64));
+	}
+
+	/*
+	 * Steps 1 thru 5, with the blocks split among state->blockThreads threads
+	 */
+	runBlocks(thread_state, N, LinearComplexity_blocks, share, sizeof(share[0]));
+	memset(stat.v, 0, sizeof(stat.v));
+	for (i = 0; i < state->blockThreads; i++) {
+		for (j = 0; j < K_LINEARCOMPLEXITY + 1; j++) {
+			stat.v[j] += share[i].v[j];
 		}
 	}
 
@@ -390,35 +476,28 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	 */
 	p_value = cephes_igamc(K_LINEARCOMPLEXITY / 2.0, stat.chi2 / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -426,16 +505,9 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
@@ -1165,8 +1237,6 @@ LinearComplexity_metrics(struct state *state)
 void
 LinearComplexity_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1204,21 +1274,6 @@ LinearComplexity_destroy(struct state *state)
 		state->subDir[test_num] = NULL;
 	}
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->linear_b[i] != NULL) {
-			free(state->linear_b[i]);
-			state->linear_b[i] = NULL;
-		}
-		if (state->linear_c[i] != NULL) {
-			free(state->linear_c[i]);
-			state->linear_c[i] = NULL;
-		}
-		if (state->linear_t[i] != NULL) {
-			free(state->linear_t[i]);
-			state->linear_t[i] = NULL;
-		}
-	}
-
 	if (state->linear_b != NULL) {
 		free(state->linear_b);
 		state->linear_b = NULL;
@@ -217,6 +217,7 @@ static bool LongestRunOfOnes_print_stat(FILE * stream, struct state *state, stru
 					double p_value);
 static bool LongestRunOfOnes_print_p_value(FILE * stream, double p_value);
 static void LongestRunOfOnes_metric_print(struct state *state, long int sampleCount, long int toolow, long int *freqPerBin);
+static long int longestRun(const WORD64 *packed, long int first, long int count);
 
 
 /*
@@ -295,6 +296,74 @@ LongestRunOfOnes_init(struct state *state)
 }
 
 
+/*
+ * longestRun - length of the longest run of 1 bits in a range of a packed bit stream
+ *
+ * given:
+ *      packed          // packed bit stream
+ *      first           // first bit of the range
+ *      count           // number of bits in the range
+ *
+ * returns:
+ *      length of the longest run of consecutive 1 bits within the range
+ *
+ * The range is taken up to BITS_N_WORD64 bits at a time, with the most recent bit as the least significant.
+ * The run that reaches the end of one chunk is carried into the next chunk, where it is extended by the
+ * leading 1 bits of that chunk.  The longest run within a chunk is the number of times that y &= y << 1
+ * is needed to clear a copy y of it, since each step shortens every run of 1 bits by one.
+ */
+static long int
+longestRun(const WORD64 *packed, long int first, long int count)
+{
+	WORD64 x;		// Chunk of up to BITS_N_WORD64 bits of the range, the earliest as the most significant
+	WORD64 y;		// x with every run of 1 bits shortened by the number of x &= x << 1 steps done
+	WORD64 ones;		// Value of a chunk of k 1 bits
+	long int v_obs;		// Longest run found so far
+	long int run;		// Length of the run of 1 bits that reaches the end of the previous chunk
+	long int inner;		// Longest run within the chunk
+	long int i;
+	int k;			// Number of bits in the chunk
+
+	v_obs = 0;
+	run = 0;
+	for (i = 0; i < count; i += k) {
+		k = (int) MIN(count - i, BITS_N_WORD64);
+		x = packedWindow(packed, first + i, k);
+		ones = (k == BITS_N_WORD64) ? ~(WORD64) 0 : ((WORD64) 1 << k) - 1;
+
+		/*
+		 * A chunk of all 1 bits extends the carried run
+		 */
+		if (x == ones) {
+			run += k;
+			v_obs = MAX(v_obs, run);
+			continue;
+		}
+
+		/*
+		 * Otherwise the carried run ends with the leading 1 bits of the chunk ...
+		 */
+		run += __builtin_clzll(~(x << (BITS_N_WORD64 - k)));
+		v_obs = MAX(v_obs, run);
+
+		/*
+		 * ... runs within the chunk are checked ...
+		 */
+		for (inner = 0, y = x; y != 0; inner++) {
+			y &= y << 1;
+		}
+		v_obs = MAX(v_obs, inner);
+
+		/*
+		 * ... and the trailing 1 bits of the chunk start a new carried run
+		 */
+		run = __builtin_ctzll(~x);
+	}
+
+	return v_obs;
+}
+
+
 /*
  * LongestRunOfOnes_iterate - iterate one bit stream for Longest Runs test
  *
@@ -316,9 +385,8 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	int max_class;		// Maximum length to consider
 	long int v_obs;		// Current maximum run length for current block
 	double chi_term;	// Term for the statistic formula: chi^2 = chi_term * chi_term
-	long int run;		// Counter used to find longest run of ones
 	long int i;
-	long int j;
+	struct result_shard *shard;	// Where this thread records the Longest Run counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -330,15 +398,19 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(111, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(111, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(111, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(111, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(111, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(111, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 
 	/*
@@ -381,18 +453,7 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 		/*
 		 * Step 2a: determine maximum 1-bit run length for this block
 		 */
-		v_obs = 0;
-		run = 0;
-		for (j = 0; j < stat.M; j++) {
-			if (state->epsilon[thread_state->thread_id][(i * stat.M) + j] == 1) {
-				run++;
-				if (run > v_obs) {
-					v_obs = run;
-				}
-			} else {
-				run = 0;
-			}
-		}
+		v_obs = longestRun(state->packedEpsilon[thread_state->thread_id], i * stat.M, stat.M);
 
 		/*
 		 * Step 2b: count the class based on the current run length
@@ -420,35 +481,28 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	 */
 	p_value = cephes_igamc((double) CLASS_COUNT_LONGEST_RUN / 2.0, stat.chi2 / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -456,16 +510,9 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
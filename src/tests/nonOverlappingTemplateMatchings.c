@@ -162,6 +162,7 @@ static const long int numOfTemplates[MAXTEMPLEN + 1] = {
  * Forward static function declarations
  */
 static void appendTemplate(struct state *state, ULONG value, long int m);
+static void NonOverlappingTemplateMatchings_blocks(struct block_range *range);
 static bool NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 						       struct NonOverlappingTemplateMatchings_private_stats *stat,
 						       struct dyn_array *nonover_stats, long int nonstat_index);
@@ -186,7 +187,10 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	long int M;		// Length of each block to be tested
 	long int m;		// Length of a template
 	ULONG max_num;		// Max decimal value of a template
+	ULONG window;		// Value of a template as an m bit window, first bit most significant
 	ULONG i;
+	long int jj;
+	long int k;
 
 	/*
 	 * Check preconditions (firewall)
@@ -245,19 +249,23 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	}
 
 	/*
-	 * Allocate special BitSequence
+	 * Allocate the slots, for each share of each thread, of the first position where each template may next
+	 * match in a block.  The positions themselves are taken by each iteration from the scratch arena of its thread.
 	 */
-	state->nonper_seq = malloc((size_t) state->numberOfThreads * sizeof(*state->nonper_seq));
-	if (state->nonper_seq == NULL) {
-		errp(130, __func__, "cannot malloc for nonper_seq: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->nonper_seq));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->nonper_seq[i] = malloc(m * sizeof(state->nonper_seq[i][0]));
-		if (state->nonper_seq[i] == NULL) {
-			errp(130, __func__, "cannot malloc of %ld elements of %ld bytes each for state->nonper_seq[%ul]",
-			     m, sizeof(state->nonper_seq[i][0]), i);
-		}
+	state->nonovNextMatch = calloc((size_t) state->numberOfThreads * state->blockThreads, sizeof(*state->nonovNextMatch));
+	if (state->nonovNextMatch == NULL) {
+		errp(130, __func__, "cannot calloc for nonovNextMatch: %ld elements of %lu bytes each",
+		     state->numberOfThreads * state->blockThreads, sizeof(*state->nonovNextMatch));
+	}
+
+	/*
+	 * Reserve the stats of each template, and the template occurrences counted and the next match positions
+	 * of each share of the blocks of an iteration, in the scratch arena of each thread
+	 */
+	reserveScratch(state, (size_t) numOfTemplates[m] * sizeof(struct nonover_stats));
+	reserveScratch(state, (size_t) state->blockThreads * numOfTemplates[m] * sizeof(struct nonover_stats));
+	for (i = 0; i < state->blockThreads; i++) {
+		reserveScratch(state, (size_t) numOfTemplates[m] * sizeof(long int));
 	}
 
 	/*
@@ -307,6 +315,25 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	}
 	dbg(DBG_HIGH, "Formed an array of %ld non-overlapping templates of %ld bytes each", numOfTemplates[m], m);
 
+	/*
+	 * Map each of the 2^m possible m bit windows to the index of its template, or to -1 if it is not a template
+	 */
+	state->nonovTemplateIndex = malloc((size_t) max_num * sizeof(state->nonovTemplateIndex[0]));
+	if (state->nonovTemplateIndex == NULL) {
+		errp(130, __func__, "cannot malloc of %lu elements of %ld bytes each for state->nonovTemplateIndex",
+		     (unsigned long) max_num, sizeof(state->nonovTemplateIndex[0]));
+	}
+	for (i = 0; i < max_num; i++) {
+		state->nonovTemplateIndex[i] = -1;
+	}
+	for (jj = 0; jj < numOfTemplates[m]; jj++) {
+		window = 0;
+		for (k = 0; k < m; k++) {
+			window = (window << 1) | get_value(state->nonovTemplates, BitSequence, m * jj + k);
+		}
+		state->nonovTemplateIndex[window] = jj;
+	}
+
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
 	 */
@@ -420,15 +447,14 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 {
 	struct NonOverlappingTemplateMatchings_private_stats stat;	// Stats for this iteration
 	struct nonover_stats *nonover_stats;	// Stats for a template of this iteration
+	struct nonover_stats *share;		// Template occurrences counted by each share of the blocks
 	long int n;				// Length of a single bit stream
 	long int m;				// NonOverlapping Template Test - block length
-	unsigned int W_obs;			// Counter of the number of occurrences of a template in a block
 	double chi2_term;			// Term used to compute chi squared
-	bool match;				// Indicator of a match of a template in a block
 	long int i;
 	long int j;
 	long int jj;
-	long int k;
+	struct result_shard *shard;	// Where this thread records the counts and p_value of each template
 
 	/*
 	 * Check preconditions (firewall)
@@ -440,6 +466,10 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(132, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(132, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] == false) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when testVector was false", test_num, __func__);
 		return;
@@ -448,17 +478,17 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		dbg(DBG_LOW, "iterate function[%d] %s called when testNames was NULL", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(132, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(132, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(132, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(132, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
-	if (state->nonper_seq == NULL) {
-		err(132, __func__, "state->nonper_seq is NULL");
+	if (state->nonovTemplateIndex == NULL) {
+		err(132, __func__, "state->nonovTemplateIndex is NULL");
 	}
-	if (state->nonper_seq[thread_state->thread_id] == NULL) {
-		err(132, __func__, "state->nonper_seq[%ld] is NULL", thread_state->thread_id);
+	if (state->nonovNextMatch == NULL) {
+		err(132, __func__, "state->nonovNextMatch is NULL");
 	}
 
 	/*
@@ -495,65 +525,34 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	/*
 	 * Initialize array of nonover_stats
 	 */
-	nonover_stats = malloc((size_t) numOfTemplates[m] * sizeof(*nonover_stats));
+	nonover_stats = scratchAlloc(thread_state, (size_t) numOfTemplates[m] * sizeof(*nonover_stats));
 
 	/*
-	 * Process all template values
+	 * Step 2: count the number of times that each template occurs within each block,
+	 * with the blocks split among state->blockThreads threads
 	 */
+	share = scratchAlloc(thread_state, (size_t) state->blockThreads * numOfTemplates[m] * sizeof(share[0]));
+	for (i = 0; i < state->blockThreads; i++) {
+		state->nonovNextMatch[thread_state->thread_id * state->blockThreads + i] =
+		    scratchAlloc(thread_state, (size_t) numOfTemplates[m] * sizeof(long int));
+	}
+	runBlocks(thread_state, BLOCKS_NON_OVERLAPPING, NonOverlappingTemplateMatchings_blocks, share,
+		  (size_t) numOfTemplates[m] * sizeof(share[0]));
 	for (jj = 0; jj < numOfTemplates[m]; jj++) {
-
-		struct nonover_stats nonover_stat;
-
-		/*
-		 * Get the next template from the pool of precomputed ones
-		 */
-		memcpy(state->nonper_seq[thread_state->thread_id], addr_value(state->nonovTemplates, BitSequence, m * jj),
-		       m * sizeof(BitSequence));
-
-		/*
-		 * Zeroize the occurrences counters for this template
-		 */
-		memset(nonover_stat.Wj, 0, sizeof(nonover_stat.Wj));
-
-		/*
-	 	 * Step 2: count the number of times that this template occurs within each block
-	 	 */
-		for (i = 0; i < BLOCKS_NON_OVERLAPPING; i++) {
-			W_obs = 0;
-
-			/*
-			 * Count occurrences of the current template in block i
-			 */
-			for (j = 0; j < stat.M - m + 1; j++) {
-				match = true;
-
-				/*
-				 * Check if all the m bits of the template match the bits being
-				 * considered in the block.
-				 */
-				for (k = 0; k < m; k++) {
-					if (state->nonper_seq[thread_state->thread_id][k] !=
-							state->epsilon[thread_state->thread_id][i * stat.M + j + k]) {
-						match = false;
-						break;
-					}
-				}
-
-				/*
-				 * If all the bits match, count one occurrence of this template and
-				 * slide the window over m bits.
-				 */
-				if (match == true) {
-					W_obs++;
-					j += m - 1;
-				}
+		memset(nonover_stats[jj].Wj, 0, sizeof(nonover_stats[jj].Wj));
+		for (j = 0; j < state->blockThreads; j++) {
+			for (i = 0; i < BLOCKS_NON_OVERLAPPING; i++) {
+				nonover_stats[jj].Wj[i] += share[j * numOfTemplates[m] + jj].Wj[i];
 			}
-
-			/*
-			 * Store the count of occurrences found in this block
-			 */
-			nonover_stat.Wj[i] = W_obs;
 		}
+	}
+
+	/*
+	 * Process all template values
+	 */
+	for (jj = 0; jj < numOfTemplates[m]; jj++) {
+
+		struct nonover_stats nonover_stat = nonover_stats[jj];
 
 		/*
 		 * Step 4: compute the test statistic
@@ -576,13 +575,6 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		nonover_stats[jj] = nonover_stat;
 	}
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record stats and p-values for each template tested
 	 */
@@ -596,27 +588,27 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		/*
 		 * Record success or failure for this iteration
 		 */
-		state->count[test_num]++;	// Count this iteration
-		state->valid[test_num]++;	// Count this valid iteration
+		shard->count[test_num]++;	// Count this iteration
+		shard->valid[test_num]++;	// Count this valid iteration
 		if (isNegative(nonover_stat.p_value)) {
-			state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+			shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 			nonover_stat.success = false;	// FAILURE
 			warn(__func__, "iteration %ld template[%ld] of test %s[%d] produced bogus p_value: %f < 0.0\n",
 			     thread_state->iteration_being_done + 1, jj, state->testNames[test_num], test_num,
 			     nonover_stat.p_value);
 		} else if (isGreaterThanOne(nonover_stat.p_value)) {
-			state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+			shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 			nonover_stat.success = false;	// FAILURE
 			warn(__func__, "iteration %ld template[%ld] of test %s[%d] produced bogus p_value: %f > 1.0\n",
 			     thread_state->iteration_being_done + 1, jj, state->testNames[test_num], test_num,
 			     nonover_stat.p_value);
 		} else if (nonover_stat.p_value < state->tp.alpha) {
-			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-			state->failure[test_num]++;	// Valid p_value but too low is a failure
+			shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+			shard->failure[test_num]++;	// Valid p_value but too low is a failure
 			nonover_stat.success = false;	// FAILURE
 		} else {
-			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-			state->success[test_num]++;	// Valid p_value not too low is a success
+			shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+			shard->success[test_num]++;	// Valid p_value not too low is a success
 			nonover_stat.success = true;	// SUCCESS
 		}
 
@@ -624,7 +616,7 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		 * Record non-over stats computed during this iteration
 		 * This is the only case when we append a struct to the p-value array.
 		 */
-		append_value(state->p_val[test_num], &nonover_stat);
+		append_value(shard->p_val[test_num], &nonover_stat);
 	}
 
 	/*
@@ -636,17 +628,74 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	 * NOTE: The number of nonover_stat values in state->p_val is numOfTemplates[m].
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
+		append_value(shard->stats[test_num], &stat);
 	}
 
+	return;
+}
+
+
+/*
+ * NonOverlappingTemplateMatchings_blocks - count template occurrences in one share of the blocks of an iteration
+ *
+ * given:
+ *      range           // share of the blocks to scan (see runBlocks())
+ *
+ * The occurrences of template jj in block i are added to the Wj[i] field of the jj-th
+ * struct nonover_stats at range->result.
+ *
+ * Rather than scanning each block once per template, we slide a single m bit window over
+ * the block and look up the template, if any, that the window matches.  Each template
+ * remembers where its last match ended, so that, just as when scanning for that template
+ * alone, a template only counts matches that do not overlap one another.
+ */
+static void
+NonOverlappingTemplateMatchings_blocks(struct block_range *range)
+{
+	struct nonover_stats *nonover_stats;	// Template occurrences of this share
+	WORD64 *packed;				// Packed bit stream of this iteration
+	long int *nextMatch;			// First position in the block where each template may match
+	long int M;				// Length in bits of each block
+	long int m;				// NonOverlapping Template Test - block length
+	long int start;				// Position of the first bit of the block
+	ULONG window;				// The m bits being considered in the block, first bit most significant
+	ULONG mask;				// The low m bits set
+	long int i;
+	long int j;
+	long int jj;
+
 	/*
-	 * Unlock mutex after making changes to the shared state
+	 * Check preconditions (firewall)
 	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+	if (range == NULL) {
+		err(132, __func__, "range arg is NULL");
+	}
+	struct state *state = range->thread_state->global_state;
+	if (state->nonovNextMatch[range->slot] == NULL) {
+		err(132, __func__, "state->nonovNextMatch[%ld] is NULL", range->slot);
 	}
+	nonover_stats = range->result;
+	packed = state->packedEpsilon[range->thread_state->thread_id];
+	nextMatch = state->nonovNextMatch[range->slot];
+	m = state->tp.nonOverlappingTemplateLength;
+	M = state->tp.n / BLOCKS_NON_OVERLAPPING;
+	mask = ((ULONG) 1 << m) - 1;
 
-	return;
+	for (i = range->first; i < range->first + range->count; i++) {
+		for (jj = 0; jj < numOfTemplates[m]; jj++) {
+			nextMatch[jj] = 0;
+		}
+		start = i * M;
+		window = (ULONG) packedWindow(packed, start, (int) (m - 1));
+		for (j = 0; j < M - m + 1; j++) {
+			window = ((window << 1) | (ULONG) packedBit(packed, start + j + m - 1)) & mask;
+			jj = state->nonovTemplateIndex[window];
+			if (jj >= 0 && j >= nextMatch[jj]) {
+				nonover_stats[jj].Wj[i]++;
+				nextMatch[jj] = j + m;
+			}
+		}
+	}
 }
 
 
@@ -1446,8 +1495,6 @@ NonOverlappingTemplateMatchings_metrics(struct state *state)
 void
 NonOverlappingTemplateMatchings_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1489,15 +1536,13 @@ NonOverlappingTemplateMatchings_destroy(struct state *state)
 		free(state->nonovTemplates);
 		state->nonovTemplates = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->nonper_seq[i] != NULL) {
-			free(state->nonper_seq[i]);
-			state->nonper_seq[i] = NULL;
-		}
+	if (state->nonovTemplateIndex != NULL) {
+		free(state->nonovTemplateIndex);
+		state->nonovTemplateIndex = NULL;
 	}
-	if (state->nonper_seq != NULL) {
-		free(state->nonper_seq);
-		state->nonper_seq = NULL;
+	if (state->nonovNextMatch != NULL) {
+		free(state->nonovNextMatch);
+		state->nonovNextMatch = NULL;
 	}
 
 	return;
@@ -38,7 +38,13 @@
 #include "../utils/cephes.h"
 #include "../utils/debug.h"
 
-#define B_VALUE (1)		// The B template to be matched contains only 1 values
+/*
+ * B_VALUE - the value of every bit of the default B template to be matched
+ *
+ * NOTE: Unless -B template was given, the template is made of m B_VALUE bits, and its occurrences are
+ *	 counted from the runs of 1 bits (see countRunMatches()).
+ */
+#define B_VALUE (1)		// The default B template to be matched contains only 1 values
 
 /*
  * Private stats - stats.txt information for this test
@@ -58,7 +64,7 @@ struct OverlappingTemplateMatchings_private_stats {
 static const enum test test_num = TEST_OVERLAPPING;	// This test number
 
 /*
- * The Mathematica code to evaluate the pi terms is found in the file:
+ * The Mathematica code to evaluate the pi terms of the template of m 1 bits is found in the file:
  *      ../tools/pi_term.txt
  *
  * Or the Mathematica notebook:
@@ -68,7 +74,7 @@ static const enum test test_num = TEST_OVERLAPPING;	// This test number
  *
  * NOTE: These probabilities have been computed for m = 9 and M = 1032.
  */
-static const double pi_term[K_OVERLAPPING + 1] = {
+static const double pi_term_ones[K_OVERLAPPING + 1] = {
 	0.36409105321672786245,	// T0[[M]]/2^1032 // N (was 0.364091)
 	0.18565890010624038178,	// T1[[M]]/2^1032 // N (was 0.185659)
 	0.13938113045903269914,	// T2[[M]]/2^1032 // N (was 0.139381)
@@ -77,6 +83,20 @@ static const double pi_term[K_OVERLAPPING + 1] = {
 	0.13986544587282249192,	// 1 - previous terms (was 0.1398657)
 };
 
+/*
+ * PI_TERM_TOLERANCE - largest difference allowed between pi_term_ones[] and the pi terms computed for
+ *		       the template of m = 9 1 bits by computePiTerms()
+ */
+#define PI_TERM_TOLERANCE (1e-12)
+
+
+/*
+ * Static variables declarations
+ */
+static WORD64 template_bits;		// Bits of the B template, its first bit as the most significant
+static bool template_ones;		// true --> the B template is made of m B_VALUE bits
+static double pi_term[K_OVERLAPPING + 1];	// Probability of a block holding 0 thru K_OVERLAPPING template occurrences
+
 
 /*
  * Forward static function declarations
@@ -86,6 +106,9 @@ static bool OverlappingTemplateMatchings_print_stat(FILE * stream, struct state
 static bool OverlappingTemplateMatchings_print_p_value(FILE * stream, double p_value);
 static void OverlappingTemplateMatchings_metric_print(struct state *state, long int sampleCount, long int toolow,
 						      long int *freqPerBin);
+static long int countRunMatches(const WORD64 *packed, long int first, long int count, long int m);
+static long int countTemplateMatches(const WORD64 *packed, long int first, long int count, WORD64 template, long int m);
+static void computePiTerms(WORD64 template, long int m, double *pi);
 
 
 /*
@@ -105,6 +128,7 @@ OverlappingTemplateMatchings_init(struct state *state)
 	long int m;		// Overlapping Template Test - block length
 	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
 	double min_pi;		// Minimum pi term used for an input check
+	long int templateLength;	// Number of bits of the -B template
 	int i;
 
 	/*
@@ -130,6 +154,55 @@ OverlappingTemplateMatchings_init(struct state *state)
 	m = state->tp.overlappingTemplateLength;
 	N = n / BLOCK_LENGTH_OVERLAPPING;
 
+	/*
+	 * Disable test if the template cannot be matched
+	 *
+	 * NOTE: K and M are fixed to default values in this code, while the pi terms are computed below
+	 * for the template, which may be set with -B template and whose length m may be set with -P 3=m.
+	 */
+	if (m < 1 || m > BITS_N_WORD64) {
+		warn(__func__, "disabling test %s[%d]: requires template length m: %ld in the range [1-%d]",
+		     state->testNames[test_num], test_num, m, BITS_N_WORD64);
+		state->testVector[test_num] = false;
+		return;
+	}
+	if (state->overlappingTemplate != NULL) {
+		templateLength = (long int) strlen(state->overlappingTemplate);
+		if (templateLength != m) {
+			warn(__func__, "disabling test %s[%d]: the -B template %s has %ld bits, but m has been set to %ld",
+			     state->testNames[test_num], test_num, state->overlappingTemplate, templateLength, m);
+			state->testVector[test_num] = false;
+			return;
+		}
+	}
+
+	/*
+	 * Form the template bits, the template of m B_VALUE bits unless -B template was given
+	 */
+	if (state->overlappingTemplate == NULL) {
+		template_bits = (m == BITS_N_WORD64) ? ~(WORD64) 0 : ((WORD64) 1 << m) - 1;
+	} else {
+		template_bits = 0;
+		for (i = 0; i < m; i++) {
+			template_bits = (template_bits << 1) | (WORD64) (state->overlappingTemplate[i] == '1');
+		}
+	}
+	template_ones = (template_bits == ((m == BITS_N_WORD64) ? ~(WORD64) 0 : ((WORD64) 1 << m) - 1));
+
+	/*
+	 * Compute the pi terms of the template, and check them against pi_term_ones[] for the default template
+	 */
+	computePiTerms(template_bits, m, pi_term);
+	if (template_ones == true && m == DEFAULT_OVERLAPPING) {
+		for (i = 0; i < K_OVERLAPPING + 1; i++) {
+			if (fabs(pi_term[i] - pi_term_ones[i]) > PI_TERM_TOLERANCE) {
+				err(140, __func__, "computed pi_term[%d]: %.20f differs from pi_term_ones[%d]: %.20f",
+				    i, pi_term[i], i, pi_term_ones[i]);
+			}
+			pi_term[i] = pi_term_ones[i];
+		}
+	}
+
 	/*
 	 * Get minimum pi from the pi_term array
 	 */
@@ -140,22 +213,8 @@ OverlappingTemplateMatchings_init(struct state *state)
 
 	/*
 	 * Disable test if conditions do not permit this test from being run
-	 *
-	 * NOTE: K and M are fixed to default values in this code.
-	 * m is not really fixed (can be still set up as argument to the program), but the test is only run when it is
-	 * equal to the default value, because the probabilities in pi_terms are computed for fixed values of m and M.
-	 *
-	 * Potentially, someone might compute probabilities for different values of m and allow
-	 * different values of m to be accepted by this code.
 	 */
-	if (m != DEFAULT_OVERLAPPING) {
-		warn(__func__, "disabling test %s[%d]: the probabilities in the code of this test have been computed only"
-				     "for m = %d so far, but m has been set to %ld for this execution."
-				     "If you want to run this test please choose set the template size to %d",
-		     state->testNames[test_num], test_num, DEFAULT_OVERLAPPING, m, DEFAULT_OVERLAPPING);
-		state->testVector[test_num] = false;
-		return;
-	} else if (n < MIN_LENGTH_OVERLAPPING) {
+	if (n < MIN_LENGTH_OVERLAPPING) {
 		warn(__func__, "disabling test %s[%d]: requires bitcount(n): %ld >= %d",
 		     state->testNames[test_num], test_num, n, MIN_LENGTH_OVERLAPPING);
 		state->testVector[test_num] = false;
@@ -214,13 +273,11 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	struct OverlappingTemplateMatchings_private_stats stat;	// Stats for this iteration
 	long int m;		// Overlapping Template Test - template length
 	long int n;		// Length of a single bit stream
-	bool match;		// 1 ==> template match
 	double W_obs;		// Counter of the number of occurrences of a template in a block
 	double chi2_term;	// Term whose square is used to compute chi squared for this iteration
 	double p_value;		// p_value iteration test result(s)
 	long int i;
-	long int j;
-	long int k;
+	struct result_shard *shard;	// Where this thread records the Overlapping Template counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -232,15 +289,19 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(141, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(141, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(141, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(141, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(141, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(141, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 
 	/*
@@ -259,30 +320,16 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 
 	/*
 	 * Step 2: calculate the number of occurrences of the template in each of the N blocks of length M.
-	 * NOTE: Because the template we are checking is made only of ones, we don't need to
-	 *       allocate any array for it. We compare with the constant B_VALUE (which is 1) instead.
+	 * NOTE: When the template we are checking is made only of ones, its occurrences are counted from
+	 *	 the runs of B_VALUE bits in the block.
 	 */
 	for (i = 0; i < stat.N; i++) {
-
-		/*
-		 * Set the initial counter of the occurrences of the template in block i to zero
-		 */
-		W_obs = 0;
-
-		/*
-		 * Increase the W_obs counter whenever there is an occurrence of the template in block i
-		 */
-		for (j = 0; j < BLOCK_LENGTH_OVERLAPPING - m + 1; j++) {
-			match = true;
-			for (k = 0; k < m; k++) {
-				if (B_VALUE != state->epsilon[thread_state->thread_id][i * BLOCK_LENGTH_OVERLAPPING + j + k]) {
-					match = false;
-					break;
-				}
-			}
-			if (match == true) {
-				W_obs++;
-			}
+		if (template_ones == true) {
+			W_obs = countRunMatches(state->packedEpsilon[thread_state->thread_id], i * BLOCK_LENGTH_OVERLAPPING,
+						BLOCK_LENGTH_OVERLAPPING, m);
+		} else {
+			W_obs = countTemplateMatches(state->packedEpsilon[thread_state->thread_id], i * BLOCK_LENGTH_OVERLAPPING,
+						     BLOCK_LENGTH_OVERLAPPING, template_bits, m);
 		}
 
 		/*
@@ -309,35 +356,28 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	 */
 	p_value = cephes_igamc(K_OVERLAPPING / 2.0, stat.chi2 / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -345,15 +385,212 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
+		append_value(shard->stats[test_num], &stat);
+	}
+	append_value(shard->p_val[test_num], &p_value);
+
+	return;
+}
+
+
+/*
+ * countRunMatches - count the occurrences of the template of m 1 bits in a range of a packed bit stream
+ *
+ * given:
+ *      packed          // packed bit stream
+ *      first           // first bit of the range
+ *      count           // number of bits in the range
+ *      m               // template length
+ *
+ * returns:
+ *      number of positions of the range where m consecutive 1 bits start
+ *
+ * A run of r 1 bits holds r - m + 1 overlapping occurrences of the template when r >= m, and none otherwise.
+ * The runs are found up to BITS_N_WORD64 bits at a time by counting leading 1 bits and then leading 0 bits,
+ * with the run that reaches the end of one chunk carried into the next one.
+ */
+static long int
+countRunMatches(const WORD64 *packed, long int first, long int count, long int m)
+{
+	WORD64 x;		// Bits of the chunk not yet accounted for, the next one as the most significant
+	long int W_obs;		// Number of occurrences of the template
+	long int run;		// Length of the current run of 1 bits
+	long int i;
+	int left;		// Number of bits of the chunk not yet accounted for
+	int ones;		// Number of leading 1 bits of x
+	int zeros;		// Number of leading 0 bits of x
+	int k;			// Number of bits in the chunk
+
+	W_obs = 0;
+	run = 0;
+	for (i = 0; i < count; i += k) {
+		k = (int) MIN(count - i, BITS_N_WORD64);
+		x = packedWindow(packed, first + i, k) << (BITS_N_WORD64 - k);
+		for (left = k; left > 0; left -= zeros) {
+
+			/*
+			 * Extend the current run with the leading 1 bits, unless they reach the end of the chunk
+			 */
+			ones = (~x == 0) ? BITS_N_WORD64 : __builtin_clzll(~x);
+			if (ones >= left) {
+				run += left;
+				break;
+			}
+			run += ones;
+			W_obs += MAX(run - m + 1, 0);
+			run = 0;
+			x <<= ones;
+			left -= ones;
+
+			/*
+			 * Skip the 0 bits before the next run
+			 */
+			zeros = (x == 0) ? left : MIN(__builtin_clzll(x), left);
+			if (zeros < BITS_N_WORD64) {
+				x <<= zeros;
+			}
+		}
 	}
-	append_value(state->p_val[test_num], &p_value);
+	W_obs += MAX(run - m + 1, 0);
+
+	return W_obs;
+}
+
+
+/*
+ * countTemplateMatches - count the occurrences of an m-bit template in a range of a packed bit stream
+ *
+ * given:
+ *      packed          // packed bit stream
+ *      first           // first bit of the range
+ *      count           // number of bits in the range
+ *      template        // the m bits of the template, its first bit as the most significant
+ *      m               // template length, 1 <= m <= BITS_N_WORD64
+ *
+ * returns:
+ *      number of positions of the range where the template starts, counting overlapping occurrences
+ *
+ * Up to BITS_N_WORD64 starting positions are checked at once: bit t of a match word stands for the position
+ * j + t of a chunk.  For each bit b of the template, the window starting at j + b is ANDed into the match word,
+ * inverted if bit b of the template is 0, so that only the positions where all m bits agree are left.
+ */
+static long int
+countTemplateMatches(const WORD64 *packed, long int first, long int count, WORD64 template, long int m)
+{
+	WORD64 match;		// Positions of the chunk where the template bits checked so far match
+	WORD64 window;		// Bits of the range at the positions of the chunk plus b
+	long int W_obs;		// Number of occurrences of the template
+	long int j;
+	long int b;
+	int k;			// Number of starting positions in the chunk
+
+	W_obs = 0;
+	for (j = 0; j <= count - m; j += k) {
+		k = (int) MIN(count - m + 1 - j, BITS_N_WORD64);
+		match = (k == BITS_N_WORD64) ? ~(WORD64) 0 : ((WORD64) 1 << k) - 1;
+		for (b = 0; b < m && match != 0; b++) {
+			window = packedWindow(packed, first + j + b, k);
+			match &= ((template >> (m - 1 - b)) & 1) ? window : ~window;
+		}
+		W_obs += __builtin_popcountll(match);
+	}
+
+	return W_obs;
+}
+
+
+/*
+ * computePiTerms - compute the probabilities of the number of occurrences of a template in a random block
+ *
+ * given:
+ *      template        // the m bits of the template, its first bit as the most significant
+ *      m               // template length, 1 <= m <= BITS_N_WORD64
+ *      pi              // array of K_OVERLAPPING + 1 probabilities to set
+ *
+ * pi[i] is set to the probability that a block of BLOCK_LENGTH_OVERLAPPING random bits holds i overlapping
+ * occurrences of the template, and pi[K_OVERLAPPING] to the probability that it holds K_OVERLAPPING or more.
+ *
+ * The block is read one bit at a time through the automaton whose state s is the length of the longest
+ * prefix of the template that ends the bits read so far, as in Knuth-Morris-Pratt string matching.  Each
+ * time state m is reached an occurrence ends, so the probability of each state and number of occurrences
+ * so far follows from the previous one, each bit being 0 or 1 with probability 1/2.  For the template of
+ * m 1 bits this is the exact distribution of Hamano and Kaneko (see ../tools/pi_term.txt).
+ */
+static void
+computePiTerms(WORD64 template, long int m, double *pi)
+{
+	int next[BITS_N_WORD64 + 1][2];	// next[s][b] is the state following state s when bit b is read
+	double prob[BITS_N_WORD64 + 1][K_OVERLAPPING + 1];	// Probability of each state and occurrence count
+	double step[BITS_N_WORD64 + 1][K_OVERLAPPING + 1];	// prob[][] after one more bit
+	long int s;		// State of the automaton
+	long int k;		// Length of a prefix of the template
+	long int j;
+	long int i;
+	int b;			// A bit value
+	int c;			// Number of occurrences, up to K_OVERLAPPING
+	int u;			// Bit j of the prefix of state s followed by b
+	bool prefix;		// true --> the last k bits of the prefix followed by b are the first k template bits
 
 	/*
-	 * Unlock mutex after making changes to the shared state
+	 * Check preconditions (firewall)
 	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+	if (pi == NULL) {
+		err(148, __func__, "pi arg is NULL");
+	}
+	if (m < 1 || m > BITS_N_WORD64) {
+		err(148, __func__, "m: %ld must be in the range [1-%d]", m, BITS_N_WORD64);
+	}
+
+	/*
+	 * Form the automaton: from state s, bit b leads to the longest prefix of the template that ends
+	 * the first s template bits followed by b
+	 */
+	for (s = 0; s <= m; s++) {
+		for (b = 0; b < 2; b++) {
+			for (k = MIN(s + 1, m); k > 0; k--) {
+				prefix = true;
+				for (j = 0; j < k && prefix == true; j++) {
+					i = s + 1 - k + j;
+					u = (i < s) ? (int) ((template >> (m - 1 - i)) & 1) : b;
+					prefix = (u == (int) ((template >> (m - 1 - j)) & 1));
+				}
+				if (prefix == true) {
+					break;
+				}
+			}
+			next[s][b] = (int) k;
+		}
+	}
+
+	/*
+	 * Follow the probabilities of the states and occurrence counts through the bits of a block
+	 */
+	memset(prob, 0, sizeof(prob));
+	prob[0][0] = 1.0;
+	for (i = 0; i < BLOCK_LENGTH_OVERLAPPING; i++) {
+		memset(step, 0, sizeof(step));
+		for (s = 0; s <= m; s++) {
+			for (c = 0; c <= K_OVERLAPPING; c++) {
+				if (prob[s][c] == 0.0) {
+					continue;
+				}
+				for (b = 0; b < 2; b++) {
+					k = next[s][b];
+					step[k][MIN(c + (k == m), K_OVERLAPPING)] += prob[s][c] / 2.0;
+				}
+			}
+		}
+		memcpy(prob, step, sizeof(prob));
+	}
+
+	/*
+	 * Add up the probabilities of each occurrence count over the states
+	 */
+	for (c = 0; c <= K_OVERLAPPING; c++) {
+		pi[c] = 0.0;
+		for (s = 0; s <= m; s++) {
+			pi[c] += prob[s][c];
+		}
 	}
 
 	return;
@@ -399,7 +636,11 @@ OverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state, stru
 	 * Print stat to a file
 	 */
 	if (state->legacy_output == true) {
-		io_ret = fprintf(stream, "\t\t    OVERLAPPING TEMPLATE OF ALL ONES TEST\n");
+		if (state->overlappingTemplate == NULL) {
+			io_ret = fprintf(stream, "\t\t    OVERLAPPING TEMPLATE OF ALL ONES TEST\n");
+		} else {
+			io_ret = fprintf(stream, "\t\t    OVERLAPPING TEMPLATE TEST\n");
+		}
 		if (io_ret <= 0) {
 			return false;
 		}
@@ -412,7 +653,11 @@ OverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state, stru
 			return false;
 		}
 	} else {
-		io_ret = fprintf(stream, "\t\t    Overlapping template of all ones test\n");
+		if (state->overlappingTemplate == NULL) {
+			io_ret = fprintf(stream, "\t\t    Overlapping template of all ones test\n");
+		} else {
+			io_ret = fprintf(stream, "\t\t    Overlapping template test\n");
+		}
 		if (io_ret <= 0) {
 			return false;
 		}
@@ -425,9 +670,20 @@ OverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state, stru
 	if (io_ret <= 0) {
 		return false;
 	}
-	io_ret = fprintf(stream, "\t\t(b) m (block length of 1s)   = %ld\n", state->tp.overlappingTemplateLength);
-	if (io_ret <= 0) {
-		return false;
+	if (state->overlappingTemplate == NULL) {
+		io_ret = fprintf(stream, "\t\t(b) m (block length of 1s)   = %ld\n", state->tp.overlappingTemplateLength);
+		if (io_ret <= 0) {
+			return false;
+		}
+	} else {
+		io_ret = fprintf(stream, "\t\t(b) m (template length)      = %ld\n", state->tp.overlappingTemplateLength);
+		if (io_ret <= 0) {
+			return false;
+		}
+		io_ret = fprintf(stream, "\t\t(c) B (template)             = %s\n", state->overlappingTemplate);
+		if (io_ret <= 0) {
+			return false;
+		}
 	}
 	io_ret = fprintf(stream, "\t\t(d) N (number of substrings) = %ld\n", stat->N);
 	if (io_ret <= 0) {
@@ -117,26 +117,14 @@ RandomExcursions_init(struct state *state)
 	}
 
 	/*
-	 * Allocate the partial sums and the cycle arrays for each thread
+	 * The visits to each state within each cycle come from the shared random walk of each thread
 	 */
-	state->rnd_excursion_S = malloc((size_t) state->numberOfThreads * sizeof(*state->rnd_excursion_S));
-	if (state->rnd_excursion_S == NULL) {
-		errp(150, __func__, "cannot malloc for rnd_excursion_S: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->rnd_excursion_S));
-	}
-	state->rnd_excursion_cycle = malloc((size_t) state->numberOfThreads * sizeof(*state->rnd_excursion_cycle));
-	if (state->rnd_excursion_cycle == NULL) {
-		errp(150, __func__, "cannot malloc for rnd_excursion_cycle: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->rnd_excursion_cycle));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->rnd_excursion_S[i] = malloc(n * sizeof(state->rnd_excursion_S[i][0]));
-		if (state->rnd_excursion_S[i] == NULL) {
-			errp(150, __func__, "cannot malloc of %ld elements of %ld bytes each for state->rnd_excursion_S[%ld]",
-			     n, sizeof(state->rnd_excursion_S[i][0]), i);
-		}
-		state->rnd_excursion_cycle[i] = create_dyn_array(sizeof(long int), DEFAULT_CHUNK, (long int) state->c.sqrtn, true);
-	}
+	state->walkVisitsNeeded = true;
+
+	/*
+	 * Reserve the p-values of an iteration in the scratch arena of each thread
+	 */
+	reserveScratch(state, NUMBER_OF_STATES_RND_EXCURSION * sizeof(double));
 
 	/*
 	 * Create working sub-directory if forming files such as results.txt and stats.txt
@@ -242,22 +230,16 @@ void
 RandomExcursions_iterate(struct thread_state *thread_state)
 {
 	struct RandomExcursions_private_stats stat;	// Stats for this iteration
-	long int n;					// Length of a single bit stream
 	long int v[DEGREES_OF_FREEDOM_RND_EXCURSION][NUMBER_OF_STATES_RND_EXCURSION];	// Global frequency counters
-	struct dyn_array *cycle;	// Counter used for single iterations
-	long int *S;			// Array of the partial sums of the -1/+1 states
-	long int count_index;		// Index of the count array to be incremented
-	long int offset;		// Sum offset used to get the index of a state value in the counter array
+	struct walk *walk;		// Random walk of the partial sums of the -1/+1 states
 	long int x;			// State value to test
 	long int labs_x;		// Absolute value of the state value x
-	long int cycleStart;		// Index where a cycle starts
-	long int cycleStop;		// Index where a cycle ends
-	long int occurrences;		// Number of occurrences of a given state value in a cycle
 	double p_value;			// p_value iteration test result(s)
 	double *p_values;		// Array of p-values produced by this test
 	double sum_term;		// Value whose square is used to compute the test statistic
 	long int i;
 	long int j;
+	struct result_shard *shard;	// Where this thread records the counts and p_value of each excursion state
 
 	/*
 	 * Check preconditions (firewall)
@@ -269,88 +251,47 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(151, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(151, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(151, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(151, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(151, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->rnd_excursion_stateX == NULL) {
 		err(151, __func__, "state->rnd_excursion_stateX is NULL");
 	}
-	if (state->rnd_excursion_S == NULL) {
-		err(151, __func__, "state->rnd_excursion_S is NULL");
-	}
-	if (state->rnd_excursion_S[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->rnd_excursion_S[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->rnd_excursion_cycle == NULL) {
-		err(151, __func__, "state->rnd_excursion_cycle is NULL");
-	}
-	if (state->rnd_excursion_cycle[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->rnd_excursion_cycle[%ld] is NULL", thread_state->thread_id);
+	if (state->walkVisitsNeeded != true) {
+		err(151, __func__, "state->walkVisitsNeeded is not true");
 	}
 	if (state->cSetup != true) {
 		err(151, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
 	}
 
-	/*
-	 * Collect parameters from state
-	 */
-	n = state->tp.n;
-	S = state->rnd_excursion_S[thread_state->thread_id];
-	cycle = state->rnd_excursion_cycle[thread_state->thread_id];
-
-	/*
-	 * Clear the cycle array for this iteration
-	 */
-	clear_dyn_array(cycle);
-
 	/*
 	 * Step 3: compute the partial sums of successively larger sub-sequences
+	 *
+	 * Step 4a: whenever a 0 in the partial sums is found, which means that a cycle has
+	 * ended, count that cycle
+	 *
+	 * Both come from the random walk of this iteration, which is shared with other tests.
 	 */
-	if ((int) state->epsilon[thread_state->thread_id][0] == 1) {
-		S[0] = 1;
-	} else if ((int) state->epsilon[thread_state->thread_id][0] == 0) {
-		S[0] = - 1;
-	} else {
-		err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-	}
-	for (i = 1; i < n; i++) {
-		if ((int) state->epsilon[thread_state->thread_id][i] == 1) {
-			S[i] = S[i - 1] + 1;
-		} else if ((int) state->epsilon[thread_state->thread_id][i] == 0) {
-			S[i] = S[i - 1] - 1;
-		} else {
-			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-		}
-
-		/*
-		 * Step 4a: whenever a 0 in the partial sums is found, which means that a cycle has
-		 * ended, append the ending position of that cycle to the cycle array
-		 */
-		if (S[i] == 0) {
-			append_value(cycle, &i);
-		}
-	}
-
-	/*
-	 * Step 4b: count the last cycle if it was not counted already
-	 */
-	if (S[n - 1] != 0) {
-		append_value(cycle, &n);
-	}
+	walk = getWalk(state, thread_state->thread_id);
 
 	/*
+	 * Step 4b: count the last cycle if it does not end with a 0 in the partial sums
+	 *
 	 * Step 4c: get the total number of cycles.
-	 * The number of cycles will be equal to the number of elements in the cycles array.
 	 */
-	stat.number_of_cycles = cycle->count;
+	stat.number_of_cycles = walk->zeros + ((walk->final != 0) ? 1 : 0);
 
 	/*
 	 * Step 4d: determine if there are enough cycles
@@ -362,108 +303,20 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	 */
 	if (stat.test_possible == true) {
 
-		/*
-		 * Zeroize variables and global counters
-		 */
-		memset(v, 0, sizeof(v));
-		cycleStop = 0;
-
 		/*
 		 * Step 5: for each cycle and for each non-zero state value x,
 		 * compute the frequency of each x within each cycle.
+		 *
+		 * Step 6: for each of the states, increase the the counters of v consequently:
+		 * v[k][i] contains the exact number of cycles in which state i occurs exactly k times
+		 *
+		 * Both are counted cycle by cycle as the random walk is formed, so v is the cycles of the walk.
+		 * The counters of this test are left with the visits to each state in the last cycle.
 		 */
-		for (j = 0; j < stat.number_of_cycles; j++) {
+		memcpy(v, walk->cycles, sizeof(v));
+		memcpy(stat.counter, walk->lastCycle, sizeof(stat.counter));
 
-			/*
-			 * Get beginning and ending indexes of the cycle j
-			 */
-			cycleStart = cycleStop;
-			cycleStop = get_value(cycle, long int, j);
-
-			/*
-			 * Zeroize the counters for this test
-			 */
-			memset(stat.counter, 0, sizeof(stat.counter));
-
-			/*
-			 * Check preconditions (firewall)
-			 */
-			if (cycleStart < 0) {
-				err(151, __func__, "cycleStart: %ld < 0", cycleStart);
-			}
-			if (cycleStart > n) {
-				err(151, __func__, "cycleStart: %ld > n: %ld", cycleStart, n);
-			}
-			if (cycleStop < 0) {
-				err(151, __func__, "cycleStop: %ld < 0", cycleStop);
-			}
-			if (cycleStop > n) {
-				err(151, __func__, "cycleStop: %ld > n: %ld", cycleStop, n);
-			}
-
-			/*
-			 * Consider each partial sum value of the cycle
-			 */
-			for (i = cycleStart; i < cycleStop; i++) {
-
-				/*
-				 * Check if the value of the partial sum is one of the state values of interest
-				 */
-				if ((labs(S[i]) >= 1) && (labs(S[i]) <= MAX_EXCURSION_RND_EXCURSION)) {
-
-					/*
-					 * Get the index of this state value in the counter array.
-					 * This is done because the array cannot have negative indexes.
-					 * Thus, the most negative x will correspond to the item in index 0.
-					 *
-					 * For example, if MAX_EXCURSION_RND_EXCURSION is 4, the counter for
-					 * x = -4 is the counter[0] and the counter for x = 4 is counter[7]
-					 */
-					offset = (S[i] < 0) ? MAX_EXCURSION_RND_EXCURSION : MAX_EXCURSION_RND_EXCURSION - 1;
-					count_index = S[i] + offset;
-
-					/*
-					 * Check preconditions (firewall)
-					 */
-					if (count_index < 0) {
-						err(151, __func__, "count_index: %ld < 0", count_index);
-					}
-
-					/*
-					 * Increase the counter of the considered state value
-					 */
-					stat.counter[count_index]++;
-				}
-			}
-
-			/*
-			 * Step 6: for each of the states, increase the the counters of v consequently:
-			 * v[k][i] contains the exact number of cycles in which state i occurs exactly k times
-			 */
-			for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION; i++) {
-
-				/*
-				 * Get the number of occurrences of the state value in cycle i
-				 */
-				occurrences = stat.counter[i];
-
-				/*
-				 * If the number of occurrences is between 0 and MAX_K, count it in its counter
-				 */
-				if ((occurrences >= 0) && (occurrences < (DEGREES_OF_FREEDOM_RND_EXCURSION - 1))) {
-					v[stat.counter[i]][i]++;
-				}
-
-				/*
-				 * If the number of occurrences is bigger than MAX_K, count it in the MAX_K counter
-				 */
-				else if (occurrences >= DEGREES_OF_FREEDOM_RND_EXCURSION - 1) {
-					v[DEGREES_OF_FREEDOM_RND_EXCURSION - 1][i]++;
-				}
-			}
-		}
-
-		p_values = malloc(NUMBER_OF_STATES_RND_EXCURSION * sizeof(*p_values));
+		p_values = scratchAlloc(thread_state, NUMBER_OF_STATES_RND_EXCURSION * sizeof(*p_values));
 
 		/*
 		 * Compute the test statistic and the p-value for each of the states.
@@ -508,13 +361,6 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 			p_values[i] = p_value;
 		}
 
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
-
 		/*
 		 * Copy each p-value to the state
 		 */
@@ -528,39 +374,39 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 			/*
 			 * Record success or failure for this iteration of this state
 			 */
-			state->count[test_num]++;	// Count this iteration
-			state->valid[test_num]++;	// Count this valid iteration
+			shard->count[test_num]++;	// Count this iteration
+			shard->valid[test_num]++;	// Count this valid iteration
 			if (isNegative(p_value)) {
-				state->failure[test_num]++;		// Bogus p_value < 0.0 treated as a failure
+				shard->failure[test_num]++;		// Bogus p_value < 0.0 treated as a failure
 				stat.success[i] = false;		// FAILURE
 				warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 				     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 			} else if (isGreaterThanOne(p_value)) {
-				state->failure[test_num]++;		// Bogus p_value > 1.0 treated as a failure
+				shard->failure[test_num]++;		// Bogus p_value > 1.0 treated as a failure
 				stat.success[i] = false;		// FAILURE
 				warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 				     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 			} else if (p_value < state->tp.alpha) {
-				state->valid_p_val[test_num]++;		// Valid p_value in [0.0, 1.0] range
-				state->failure[test_num]++;		// Valid p_value but too low is a failure
+				shard->valid_p_val[test_num]++;		// Valid p_value in [0.0, 1.0] range
+				shard->failure[test_num]++;		// Valid p_value but too low is a failure
 				stat.success[i] = false;		// FAILURE
 			} else {
-				state->valid_p_val[test_num]++;		// Valid p_value in [0.0, 1.0] range
-				state->success[test_num]++;		// Valid p_value not too low is a success
+				shard->valid_p_val[test_num]++;		// Valid p_value in [0.0, 1.0] range
+				shard->success[test_num]++;		// Valid p_value not too low is a success
 				stat.success[i] = true;			// SUCCESS
 			}
 
 			/*
 			 * Record values computed during this iteration
 			 */
-			append_value(state->p_val[test_num], &p_value);
+			append_value(shard->p_val[test_num], &p_value);
 		}
 
 		/*
 		 * Record stats of this iteration
 		 */
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
 	}
 
@@ -568,17 +414,11 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	 * Record values when the test could not be performed
 	 */
 	else {
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
 
 		/*
 		 * Count this iteration, which happens to be invalid
 		 */
-		state->count[test_num]++;
+		shard->count[test_num]++;
 
 		/*
 		 * Record statistics of this invalid iteration
@@ -588,7 +428,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 		}
 		memset(stat.counter, 0, sizeof(stat.counter));
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
 
 		/*
@@ -596,17 +436,10 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 		 */
 		p_value = NON_P_VALUE;
 		for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION; i++) {
-			append_value(state->p_val[test_num], &p_value);
+			append_value(shard->p_val[test_num], &p_value);
 		}
 	}
 
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
-	}
-
 	return;
 }
 
@@ -1492,24 +1325,6 @@ RandomExcursions_destroy(struct state *state)
 		free(state->rnd_excursion_stateX);
 		state->rnd_excursion_stateX = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->rnd_excursion_S[i] != NULL) {
-			free(state->rnd_excursion_S[i]);
-			state->rnd_excursion_S[i] = NULL;
-		}
-		if (state->rnd_excursion_cycle[i] != NULL) {
-			free_dyn_array(state->rnd_excursion_cycle[i]);
-			state->rnd_excursion_cycle[i] = NULL;
-		}
-	}
-	if (state->rnd_excursion_S != NULL) {
-		free(state->rnd_excursion_S);
-		state->rnd_excursion_S = NULL;
-	}
-	if (state->rnd_excursion_cycle != NULL) {
-		free(state->rnd_excursion_cycle);
-		state->rnd_excursion_cycle = NULL;
-	}
 	// Free the theoretical probabilities matrix
 	if (state->rnd_excursion_pi_terms != NULL) {
 
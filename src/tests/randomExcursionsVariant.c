@@ -114,6 +114,11 @@ RandomExcursionsVariant_init(struct state *state)
 		return;
 	}
 
+	/*
+	 * Reserve the p-values of an iteration in the scratch arena of each thread
+	 */
+	reserveScratch(state, NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(double));
+
 	/*
 	 * Create working sub-directory if forming files such as results.txt and stats.txt
 	 */
@@ -140,20 +145,9 @@ RandomExcursionsVariant_init(struct state *state)
 	}
 
 	/*
-	 * Allocate partial sums working array for each thread
+	 * The visits to each state and the zeros of the partial sums come from the shared random walk of each thread
 	 */
-	state->ex_var_partial_sums = malloc((size_t) state->numberOfThreads * sizeof(*state->ex_var_partial_sums));
-	if (state->ex_var_partial_sums == NULL) {
-		errp(190, __func__, "cannot malloc for ex_var_partial_sums: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->ex_var_partial_sums));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->ex_var_partial_sums[i] = malloc(n * sizeof(state->ex_var_partial_sums[i][0]));
-		if (state->ex_var_partial_sums[i] == NULL) {
-			errp(190, __func__, "cannot malloc of %ld elements of %ld bytes each for state->ex_var_partial_sums[%ld]",
-			     state->tp.n, sizeof(state->ex_var_partial_sums[i][0]), i);
-		}
-	}
+	state->walkVisitsNeeded = true;
 
 	/*
 	 * Allocate dynamic arrays
@@ -191,12 +185,11 @@ void
 RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 {
 	struct RandomExcursionsVariant_private_stats stat;	// Stats for this iteration
-	long int n;		// Length of a single bit stream
-	long int *S;		// Array of the partial sums of the -1/+1 states
+	struct walk *walk;	// Random walk of the partial sums of the -1/+1 states
 	double p_value;		// p_value iteration test result(s)
 	double *p_values;	// Array of p-values produced by this test
 	long int i;
-	long int j;
+	struct result_shard *shard;	// Where this thread records the counts and p_value of each visited state
 
 	/*
 	 * Check preconditions (firewall)
@@ -208,73 +201,46 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(161, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(161, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(161, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(161, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(161, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(161, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->rnd_excursion_var_stateX == NULL) {
 		err(161, __func__, "state->rnd_excursion_var_stateX is NULL");
 	}
-	if (state->ex_var_partial_sums == NULL) {
-		err(161, __func__, "state->ex_var_partial_sums is NULL");
-	}
-	if (state->ex_var_partial_sums[thread_state->thread_id] == NULL) {
-		err(161, __func__, "state->ex_var_partial_sums[%ld] is NULL", thread_state->thread_id);
+	if (state->walkVisitsNeeded != true) {
+		err(161, __func__, "state->walkVisitsNeeded is not true");
 	}
 	if (state->cSetup != true) {
 		err(161, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
 	}
 
-	/*
-	 * Collect parameters from state
-	 */
-	S = state->ex_var_partial_sums[thread_state->thread_id];
-	n = state->tp.n;
-
-	/*
-	 * Set the initial value of the counter of the number of cycles
-	 */
-	stat.number_of_cycles = 0;
-
 	/*
 	 * Step 2: compute the partial sums of successively larger sub-sequences
+	 *
+	 * Step 3a: whenever a 0 in the partial sums is found, which means that a cycle has
+	 * ended, count a new cycle in the counter of cycles
+	 *
+	 * Both come from the random walk of this iteration, which is shared with other tests.
 	 */
-	if ((int) state->epsilon[thread_state->thread_id][0] == 1) {
-		S[0] = 1;
-	} else if ((int) state->epsilon[thread_state->thread_id][0] == 0) {
-		S[0] = - 1;
-	} else {
-		err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-	}
-	for (j = 1; j < n; j++) {
-		if ((int) state->epsilon[thread_state->thread_id][j] == 1) {
-			S[j] = S[j - 1] + 1;
-		} else if ((int) state->epsilon[thread_state->thread_id][j] == 0) {
-			S[j] = S[j - 1] - 1;
-		} else {
-			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-		}
-
-		/*
-		 * Step 3a: whenever a 0 in the partial sums is found, which means that a cycle has
-		 * ended, count a new cycle in the counter of cycles
-		 */
-		if (S[j] == 0) {
-			stat.number_of_cycles++;
-		}
-	}
+	walk = getWalk(state, thread_state->thread_id);
+	stat.number_of_cycles = walk->zeros;
 
 	/*
 	 * Step 3b: count the last cycle if it was not counted already
 	 */
-	if (S[n - 1] != 0) {
+	if (walk->final != 0) {
 		stat.number_of_cycles++;
 	}
 
@@ -288,7 +254,7 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	 */
 	if (stat.test_possible == true) {
 
-		p_values = malloc(NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(*p_values));
+		p_values = scratchAlloc(thread_state, NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(*p_values));
 
 		/*
 		 * For each of the state values, compute the test statistic and the p-value
@@ -297,13 +263,10 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 
 			/*
 			 * Step 4: count times when the partial sum matches this excursion state value
+			 *
+			 * They were counted as the random walk was formed.
 			 */
-			stat.counter[i] = 0;
-			for (j = 0; j < n; j++) {
-				if (S[j] == state->rnd_excursion_var_stateX[i]) {
-					stat.counter[i]++;
-				}
-			}
+			stat.counter[i] = walk->visits[i];
 
 			/*
 			 * Step 5: compute the test p-value for this excursion state value
@@ -318,13 +281,6 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 			p_values[i] = p_value;
 		}
 
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
-
 		/*
 		 * Copy each p-value to the state
 		 */
@@ -338,39 +294,39 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 			/*
 			 * Record success or failure for this iteration
 			 */
-			state->count[test_num]++;	// Count this iteration
-			state->valid[test_num]++;	// Count this valid iteration
+			shard->count[test_num]++;	// Count this iteration
+			shard->valid[test_num]++;	// Count this valid iteration
 			if (isNegative(p_value)) {
-				state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+				shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 				stat.success[i] = false;	// FAILURE
 				warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 				     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 			} else if (isGreaterThanOne(p_value)) {
-				state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+				shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 				stat.success[i] = false;	// FAILURE
 				warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 				     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 			} else if (p_value < state->tp.alpha) {
-				state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-				state->failure[test_num]++;	// Valid p_value but too low is a failure
+				shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+				shard->failure[test_num]++;	// Valid p_value but too low is a failure
 				stat.success[i] = false;	// FAILURE
 			} else {
-				state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-				state->success[test_num]++;	// Valid p_value not too low is a success
+				shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+				shard->success[test_num]++;	// Valid p_value not too low is a success
 				stat.success[i] = true;		// SUCCESS
 			}
 
 			/*
 			 * Record values computed during this iteration
 			 */
-			append_value(state->p_val[test_num], &p_value);
+			append_value(shard->p_val[test_num], &p_value);
 		}
 
 		/*
 		 * Record stats of this iteration
 		 */
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
 	}
 
@@ -379,17 +335,10 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	 */
 	else {
 
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
-
 		/*
 		 * Count this iteration, which happens to be invalid
 		 */
-		state->count[test_num]++;
+		shard->count[test_num]++;
 
 		/*
 		 * Record statistics of this invalid iteration
@@ -399,7 +348,7 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 		}
 		memset(stat.counter, 0, sizeof(stat.counter));
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
 
 		/*
@@ -407,17 +356,10 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 		 */
 		p_value = NON_P_VALUE;
 		for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION_VAR; i++) {
-			append_value(state->p_val[test_num], &p_value);
+			append_value(shard->p_val[test_num], &p_value);
 		}
 	}
 
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
-	}
-
 	return;
 }
 
@@ -1233,8 +1175,6 @@ RandomExcursionsVariant_metrics(struct state *state)
 void
 RandomExcursionsVariant_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1275,16 +1215,6 @@ RandomExcursionsVariant_destroy(struct state *state)
 		free(state->rnd_excursion_var_stateX);
 		state->rnd_excursion_var_stateX = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->ex_var_partial_sums[i] != NULL) {
-			free(state->ex_var_partial_sums[i]);
-			state->ex_var_partial_sums[i] = NULL;
-		}
-	}
-	if (state->ex_var_partial_sums != NULL) {
-		free(state->ex_var_partial_sums);
-		state->ex_var_partial_sums = NULL;
-	}
 
 	return;
 }
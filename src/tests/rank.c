@@ -73,6 +73,7 @@ static long int matrix_count;		// Total possible matrix for a given bit stream l
  */
 static bool Rank_print_stat(FILE * stream, struct state *state, struct Rank_private_stats *stat, double p_value);
 static bool Rank_print_p_value(FILE * stream, double p_value);
+static void Rank_blocks(struct block_range *range);
 static void Rank_metric_print(struct state *state, long int sampleCount, long int toolow, long int *freqPerBin);
 
 
@@ -178,15 +179,23 @@ Rank_init(struct state *state)
 	}
 
 	/*
-	 * Allocate the array for the rank test matrices for each thread
+	 * Allocate the slots of the rank test matrices for each thread and each of its block threads
+	 *
+	 * The matrices themselves are taken by each iteration from the scratch arena of its thread, one for each
+	 * share of the matrices.
 	 */
-	state->rank_matrix = malloc((size_t) state->numberOfThreads * sizeof(*state->rank_matrix));
+	state->rank_matrix = calloc((size_t) state->numberOfThreads * state->blockThreads, sizeof(*state->rank_matrix));
 	if (state->rank_matrix == NULL) {
-		errp(50, __func__, "cannot malloc for rank_matrix: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->rank_matrix));
+		errp(50, __func__, "cannot calloc for rank_matrix: %ld elements of %ld bytes each",
+		     state->numberOfThreads * state->blockThreads, sizeof(*state->rank_matrix));
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->rank_matrix[i] = create_matrix(NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK);
+
+	/*
+	 * Reserve the rank counts and the matrix of each share of an iteration in the scratch arena of each thread
+	 */
+	reserveScratch(state, (size_t) state->blockThreads * sizeof(struct Rank_private_stats));
+	for (i = 0; i < state->blockThreads; i++) {
+		reserveScratch(state, (size_t) NUMBER_OF_ROWS_RANK * MATRIX_ROW_WORDS(NUMBER_OF_COLS_RANK) * sizeof(WORD64));
 	}
 
 	/*
@@ -233,12 +242,10 @@ void
 Rank_iterate(struct thread_state *thread_state)
 {
 	struct Rank_private_stats stat;	// Stats for this iteration
-	BitSequence **matrix;		// The matrix state->rank_matrix
-	BitSequence *row;		// A row of the matrix state->rank_matrix
-	int R;				// Rank of a given NUMBER_OF_ROWS_RANK by NUMBER_OF_COLS_RANK matrix
+	struct Rank_private_stats *share;	// Rank counts of each share of the matrices
 	double p_value;			// p_value iteration test result(s)
-	long int k;
 	long int i;
+	struct result_shard *shard;	// Where this thread records the Rank counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -250,76 +257,46 @@ Rank_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(171, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(171, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(171, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(171, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(171, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(171, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->rank_matrix == NULL) {
 		err(171, __func__, "state->rank_matrix is NULL");
 	}
-	if (state->rank_matrix[thread_state->thread_id] == NULL) {
-		err(171, __func__, "state->rank_matrix[%ld] is NULL", thread_state->thread_id);
-	}
 	if (state->cSetup != true) {
 		err(171, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
 	}
 
 	/*
-	 * Setup test parameters
+	 * Take the rank counts and the matrix of each share from the scratch arena of this thread
 	 */
-	matrix = state->rank_matrix[thread_state->thread_id];
-	stat.F_M = 0;
-	stat.F_M_minus_one = 0;
-
-	/*
-	 * Zeroize the Rank test matrix
-	 */
-	for (i = 0; i < NUMBER_OF_ROWS_RANK; ++i) {
-
-		/*
-		 * Find the row
-		 */
-		row = matrix[i];
-		if (row == NULL) {	// paranoia
-			err(171, __func__, "row pointer %ld of rank_matrix is NULL", i);
-		}
-
-		/*
-		 * Zeroize the full row
-		 */
-		memset(row, 0, NUMBER_OF_COLS_RANK * sizeof(row[0]));
+	share = scratchAlloc(thread_state, (size_t) state->blockThreads * sizeof(share[0]));
+	for (i = 0; i < state->blockThreads; i++) {
+		state->rank_matrix[thread_state->thread_id * state->blockThreads + i] =
+		    scratchAlloc(thread_state, (size_t) NUMBER_OF_ROWS_RANK * MATRIX_ROW_WORDS(NUMBER_OF_COLS_RANK) * sizeof(WORD64));
 	}
 
 	/*
-	 * Step 1a: divide the sequence into disjoint blocks of NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK bits
+	 * Steps 1 thru 3a, with the matrices split among state->blockThreads threads
 	 */
-	for (k = 0; k < matrix_count; k++) {
-
-		/*
-	 	 * Step 1b: copy bits of each block into a NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK matrix
-	 	 */
-		def_matrix(thread_state, NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix, k);
-
-		/*
-	 	 * Step 2: determine the binary rank of each matrix
-	 	 */
-		R = computeRank(NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix);
-
-		/*
-		 * Step 3a: count the number of matrices with rank = (full rank) and rank = (full rank - 1)
-		 */
-		if (R == NUMBER_OF_ROWS_RANK) {
-			stat.F_M++;	// rank NUMBER_OF_ROWS_RANK found
-		} else if (R == (NUMBER_OF_ROWS_RANK - 1)) {
-			stat.F_M_minus_one++;	// rank NUMBER_OF_ROWS_RANK-1 found
-		}
+	runBlocks(thread_state, matrix_count, Rank_blocks, share, sizeof(share[0]));
+	stat.F_M = 0;
+	stat.F_M_minus_one = 0;
+	for (i = 0; i < state->blockThreads; i++) {
+		stat.F_M += share[i].F_M;
+		stat.F_M_minus_one += share[i].F_M_minus_one;
 	}
 
 	/*
@@ -345,35 +322,28 @@ Rank_iterate(struct thread_state *thread_state)
 	 */
 	p_value = exp(-stat.chi_squared / 2.0);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -381,18 +351,67 @@ Rank_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
+		append_value(shard->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	append_value(shard->p_val[test_num], &p_value);
+
+	return;
+}
+
+
+/*
+ * Rank_blocks - count the matrices of full rank and of full rank - 1 in one share of an iteration
+ *
+ * given:
+ *      range           // share of the matrices to count (see runBlocks())
+ *
+ * The counts are added to the F_M and F_M_minus_one fields of the struct Rank_private_stats at range->result.
+ */
+static void
+Rank_blocks(struct block_range *range)
+{
+	struct Rank_private_stats *stat;	// Rank counts of this share
+	WORD64 *matrix;			// The matrix state->rank_matrix of this share
+	int R;				// Rank of a given NUMBER_OF_ROWS_RANK by NUMBER_OF_COLS_RANK matrix
+	long int k;
 
 	/*
-	 * Unlock mutex after making changes to the shared state
+	 * Check preconditions (firewall)
 	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+	if (range == NULL) {
+		err(171, __func__, "range arg is NULL");
+	}
+	struct state *state = range->thread_state->global_state;
+	if (state->rank_matrix[range->slot] == NULL) {
+		err(171, __func__, "state->rank_matrix[%ld] is NULL", range->slot);
 	}
+	stat = range->result;
+	matrix = state->rank_matrix[range->slot];
 
-	return;
+	/*
+	 * Step 1a: divide the sequence into disjoint blocks of NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK bits
+	 */
+	for (k = range->first; k < range->first + range->count; k++) {
+
+		/*
+	 	 * Step 1b: copy bits of each block into a NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK matrix
+	 	 */
+		def_matrix(range->thread_state, NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix, k);
+
+		/*
+	 	 * Step 2: determine the binary rank of each matrix
+	 	 */
+		R = computeRank(NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix);
+
+		/*
+		 * Step 3a: count the number of matrices with rank = (full rank) and rank = (full rank - 1)
+		 */
+		if (R == NUMBER_OF_ROWS_RANK) {
+			stat->F_M++;	// rank NUMBER_OF_ROWS_RANK found
+		} else if (R == (NUMBER_OF_ROWS_RANK - 1)) {
+			stat->F_M_minus_one++;	// rank NUMBER_OF_ROWS_RANK-1 found
+		}
+	}
 }
 
 
@@ -1093,8 +1112,6 @@ Rank_metrics(struct state *state)
 void
 Rank_destroy(struct state *state)
 {
-	int i, j;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1133,20 +1150,8 @@ Rank_destroy(struct state *state)
 	}
 
 	/*
-	 * Free the matrices for each thread
+	 * Free the matrix slots of each thread
 	 */
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->rank_matrix[i] != NULL) {
-			for (j = 0; j < NUMBER_OF_ROWS_RANK; j++) {
-				if (state->rank_matrix[i][j] != NULL) {
-					free(state->rank_matrix[i][j]);
-					state->rank_matrix[i][j] = NULL;
-				}
-			}
-			free(state->rank_matrix[i]);
-			state->rank_matrix[i] = NULL;
-		}
-	}
 	if (state->rank_matrix != NULL) {
 		free(state->rank_matrix);
 		state->rank_matrix = NULL;
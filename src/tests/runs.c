@@ -175,7 +175,7 @@ Runs_iterate(struct thread_state *thread_state)
 	long int n;			// Length of a single bit stream
 	long int S;			// Number of 1 bits in the sequence
 	double p_value;			// p_value iteration test result(s)
-	long int k;
+	struct result_shard *shard;	// Where this thread records the Runs counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -187,15 +187,19 @@ Runs_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(181, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(181, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(181, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(181, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(181, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(181, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->cSetup != true) {
 		err(181, __func__, "test constants not setup prior to calling %s for %s[%d]",
@@ -210,12 +214,7 @@ Runs_iterate(struct thread_state *thread_state)
 	/*
 	 * Step 1: determine the proportion of ones in the input sequence
 	 */
-	S = 0;
-	for (k = 0; k < n; k++) {
-		if (state->epsilon[thread_state->thread_id][k]) {
-			S++;
-		}
-	}
+	S = packedPopcount(state->packedEpsilon[thread_state->thread_id], 0, n);
 	stat.pi = (double) S / (double) n;
 
 	/*
@@ -230,13 +229,10 @@ Runs_iterate(struct thread_state *thread_state)
 
 		/*
 		 * Step 3: compute the test statistic
+		 *
+		 * Every run but the first starts where a bit differs from the bit before it.
 		 */
-		stat.V_n = 1;
-		for (k = 1; k < n; k++) {
-			if (state->epsilon[thread_state->thread_id][k] != state->epsilon[thread_state->thread_id][k - 1]) {
-				stat.V_n++;
-			}
-		}
+		stat.V_n = 1 + packedTransitions(state->packedEpsilon[thread_state->thread_id], n);
 
 		/*
 		 * Step 4: compute the test P-value
@@ -245,35 +241,28 @@ Runs_iterate(struct thread_state *thread_state)
 				(2.0 * stat.pi * (1.0 - stat.pi) * sqrt2n);
 		p_value = erfc(stat.erfc_arg);
 
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
-
 		/*
 		 * Record success or failure for this iteration
 		 */
-		state->count[test_num]++;	// Count this iteration
-		state->valid[test_num]++;	// Count this valid iteration
+		shard->count[test_num]++;	// Count this iteration
+		shard->valid[test_num]++;	// Count this valid iteration
 		if (isNegative(p_value)) {
-			state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+			shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 			stat.success = false;		// FAILURE
 			warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 			     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 		} else if (isGreaterThanOne(p_value)) {
-			state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+			shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 			stat.success = false;		// FAILURE
 			warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 			     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 		} else if (p_value < state->tp.alpha) {
-			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-			state->failure[test_num]++;	// Valid p_value but too low is a failure
+			shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+			shard->failure[test_num]++;	// Valid p_value but too low is a failure
 			stat.success = false;		// FAILURE
 		} else {
-			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-			state->success[test_num]++;	// Valid p_value not too low is a success
+			shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+			shard->success[test_num]++;	// Valid p_value not too low is a success
 			stat.success = true;		// SUCCESS
 		}
 
@@ -281,9 +270,9 @@ Runs_iterate(struct thread_state *thread_state)
 		 * Record values computed during this iteration
 		 */
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
-		append_value(state->p_val[test_num], &p_value);
+		append_value(shard->p_val[test_num], &p_value);
 	}
 
 	/*
@@ -294,39 +283,25 @@ Runs_iterate(struct thread_state *thread_state)
 		/*
 		 * Count this iteration, which happens to be invalid
 		 */
-		state->count[test_num]++;
+		shard->count[test_num]++;
 
 		stat.pi = UNSET_DOUBLE;
 		stat.V_n = 0;
 		stat.erfc_arg = UNSET_DOUBLE;
 		stat.success = false;	// FAILURE
 
-		/*
-		 * Lock mutex before making changes to the shared state
-		 */
-		if (thread_state->mutex != NULL) {
-			pthread_mutex_lock(thread_state->mutex);
-		}
-
 		/*
 		 * Record statistics of this invalid iteration
 		 */
 		if (state->resultstxtFlag == true) {
-			append_value(state->stats[test_num], &stat);
+			append_value(shard->stats[test_num], &stat);
 		}
 
 		/*
 		 * Record non p-value of this invalid iteration
 		 */
 		p_value = NON_P_VALUE;
-		append_value(state->p_val[test_num], &p_value);
-	}
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->p_val[test_num], &p_value);
 	}
 
 	return;
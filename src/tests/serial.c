@@ -62,7 +62,7 @@ static const enum test test_num = TEST_SERIAL;	// This test number
 /*
  * Forward static function declarations
  */
-static double compute_psi2(struct thread_state *thread_state, long int blocksize);
+static double compute_psi2(struct thread_state *thread_state, long int blocksize, long int *v);
 static bool Serial_print_stat(FILE * stream, struct state *state, struct Serial_private_stats *stat, double p_value1,
 			      double p_value2);
 static bool Serial_print_p_value(FILE * stream, double p_value);
@@ -83,7 +83,6 @@ void
 Serial_init(struct state *state)
 {
 	long int m;		// Serial block length (state->tp.serialBlockLength)
-	long int i;
 
 	/*
 	 * Check preconditions (firewall)
@@ -122,19 +121,9 @@ Serial_init(struct state *state)
 	if (m > (BITS_N_LONGINT - 1)) {	// firewall
 		err(190, __func__, "m is too large, 1 << (m:%ld) can't be longer than %ld bits", m, BITS_N_LONGINT - 1);
 	}
+	state->patternWidth = MAX(state->patternWidth, m);	// Overlapping patterns to be counted for each iteration
 	state->serial_v_len = (long int) 1 << m;
-	state->serial_v = malloc((size_t) state->numberOfThreads * sizeof(*state->serial_v));
-	if (state->serial_v == NULL) {
-		errp(190, __func__, "cannot malloc for serial_v: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->serial_v));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->serial_v[i] = malloc(state->serial_v_len * sizeof(state->serial_v[i][0]));
-		if (state->serial_v[i] == NULL) {
-			errp(190, __func__, "cannot malloc of %ld elements of %ld bytes each for state->serial_v[%ld]",
-			     state->serial_v_len, sizeof(state->universal_T[i][0]), i);
-		}
-	}
+	reserveScratch(state, (size_t) state->serial_v_len * sizeof(long int));	// v of each thread
 
 	/*
 	 * Create working sub-directory if forming files such as results.txt and stats.txt
@@ -183,6 +172,8 @@ Serial_iterate(struct thread_state *thread_state)
 	long int m;		// Serial block length (state->tp.serialBlockLength)
 	double p_value1;	// p_value iteration test result(s) - #1
 	double p_value2;	// p_value iteration test result(s) - #2
+	long int *v;		// Frequency counts of the sub-sequences
+	struct result_shard *shard;	// Where this thread records the two Serial p_values and their counts
 
 	/*
 	 * Check preconditions (firewall)
@@ -194,6 +185,10 @@ Serial_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(191, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(191, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
@@ -205,11 +200,12 @@ Serial_iterate(struct thread_state *thread_state)
 	m = state->tp.serialBlockLength;
 
 	/*
-	 * Perform the test
+	 * Perform the test, counting into v taken from the scratch arena of this thread
 	 */
-	stat.psim0 = compute_psi2(thread_state, m);
-	stat.psim1 = compute_psi2(thread_state, m - 1);
-	stat.psim2 = compute_psi2(thread_state, m - 2);
+	v = scratchAlloc(thread_state, (size_t) state->serial_v_len * sizeof(v[0]));
+	stat.psim0 = compute_psi2(thread_state, m, v);
+	stat.psim1 = compute_psi2(thread_state, m - 1, v);
+	stat.psim2 = compute_psi2(thread_state, m - 2, v);
 
 	/*
 	 * Step 4: compute the test statistics
@@ -226,57 +222,50 @@ Serial_iterate(struct thread_state *thread_state)
 	/*
 	 * Record success or failure for this iteration (1st test)
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value1)) {
-		state->failure[test_num]++;	// Bogus p_value1 < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value1 < 0.0 treated as a failure
 		stat.success1 = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value1: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value1);
 	} else if (isGreaterThanOne(p_value1)) {
-		state->failure[test_num]++;	// Bogus p_value1 > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value1 > 1.0 treated as a failure
 		stat.success1 = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value1: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value1);
 	} else if (p_value1 < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value1 in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value1 but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value1 in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value1 but too low is a failure
 		stat.success1 = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value1 in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value1 not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value1 in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value1 not too low is a success
 		stat.success1 = true;		// SUCCESS
 	}
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration (2nd test)
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value2)) {
-		state->failure[test_num]++;	// Bogus p_value2 < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value2 < 0.0 treated as a failure
 		stat.success2 = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value2: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value2);
 	} else if (isGreaterThanOne(p_value2)) {
-		state->failure[test_num]++;	// Bogus p_value2 > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value2 > 1.0 treated as a failure
 		stat.success2 = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value2: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value2);
 	} else if (p_value2 < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value2 in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value2 but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value2 in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value2 but too low is a failure
 		stat.success2 = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value2 in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value2 not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value2 in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value2 not too low is a success
 		stat.success2 = true;		// SUCCESS
 	}
 
@@ -284,17 +273,10 @@ Serial_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value1);
-	append_value(state->p_val[test_num], &p_value2);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value1);
+	append_value(shard->p_val[test_num], &p_value2);
 
 	return;
 }
@@ -305,17 +287,16 @@ Serial_iterate(struct thread_state *thread_state)
  * given:
  *      state           // run state to test under
  *      blocksize	// length of an overlapping sub-sequence
+ *      v               // state->serial_v_len frequency counters
  *
  * This auxiliary function computes the psi-squared values needed for the
  * test statistic of the Serial test.
  */
 static double
-compute_psi2(struct thread_state *thread_state, long int blocksize)
+compute_psi2(struct thread_state *thread_state, long int blocksize, long int *v)
 {
 	long int n;		// Length of a single bit stream
 	long int powLen;	// Number of possible m-bit sub-sequences
-	long int mask;		// Bit-mask used to discard the extra bits of a sequence
-	long int dec;		// Decimal representation of an m-bit sub-sequence
 	double sum;		// Sum of the squares of all the counters, needed to compute psi-squared
 	long int i;
 
@@ -329,23 +310,14 @@ compute_psi2(struct thread_state *thread_state, long int blocksize)
 	if (state == NULL) {
 		err(192, __func__, "state arg is NULL");
 	}
-	if (state->epsilon == NULL) {
-		err(192, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(192, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
-	}
 	if ((blocksize == 0) || (blocksize == -1)) {
 		return 0.0;
 	}
 	if (blocksize > (BITS_N_LONGINT - 1)) {	// firewall
 		err(192, __func__, "m is too large, 1 << (m:%ld) can't be longer than %ld bits", blocksize, BITS_N_LONGINT - 1);
 	}
-	if (state->serial_v == NULL) {
-		err(192, __func__, "state->serial_v is NULL");
-	}
-	if (state->serial_v[thread_state->thread_id] == NULL) {
-		err(192, __func__, "state->serial_v[%ld] is NULL", thread_state->thread_id);
+	if (v == NULL) {
+		err(192, __func__, "v arg is NULL");
 	}
 
 	/*
@@ -363,60 +335,22 @@ compute_psi2(struct thread_state *thread_state, long int blocksize)
 				"1 << blocksize: %ld > state->serial_v_len: %ld ", powLen, blocksize, state->serial_v_len);
 	}
 
-	/*
-	 * Zeroize those counters in the array v
-	 */
-	memset(state->serial_v[thread_state->thread_id], 0, powLen * sizeof(state->serial_v[thread_state->thread_id][0]));
-
-	/*
-	 * Compute the mask that will be used by the algorithm
-	 */
-	mask = (1 << blocksize) - 1;
-
 	/*
 	 * Step 2: compute the frequency of all the overlapping sub-sequences
 	 *
-	 * This algorithm works by taking each consecutive overlapping sub-sequence
-	 * of length blocksize from the original sequence epsilon of length n.
-	 *
-	 * For each sub-sequence found, the decimal representation is computed and
-	 * the corresponding counter in the array v is incremented.
-	 *
-	 * It is convenient to use the decimal representation because we can more easily
-	 * store and have access to the counters of each block in the array v with size 2^blocksize.
-	 *
-	 * NOTE: i % n is used to avoid appending blocksize-1 bits in the end (as indicated in the paper)
+	 * The counts of the n overlapping sub-sequences of length blocksize, where the sub-sequences at the end
+	 * of epsilon wrap around to its start (as indicated in the paper), are stored in the array v indexed by
+	 * their decimal representation.  The sub-sequences are counted once per iteration and shared with the
+	 * other block sizes of this test and with the Approximate Entropy test.
 	 */
-	for (dec = 0, i = 0; i < n + blocksize; i++) {
-
-		/*
-		 * Get the decimal representation of the current block.
-		 * This line of code works by shifting the decimal representation of the
-		 * previous number left by 1 bit, adding to it the following bit of epsilon,
-		 * and then discarding the left-most bit by doing an AND with the mask (in fact,
-		 * the mask is used to keep only the right-most blocksize bits of the number).
-		 */
-		dec = ((dec << 1) + (int) state->epsilon[thread_state->thread_id][i % n]) & mask;
-
-		/*
-		 * If we have already counted the first (blocksize - 1) bits of epsilon,
-		 * count the occurrence of the current block in its corresponding counter.
-		 *
-		 * NOTE: this check is important because during the first (blocksize - 1) iterations
-		 * of this loop, dec will be the decimal representation of blocks of length
-		 * which is smaller than blocksize.
-		 */
-		if (i >= blocksize) {
-			state->serial_v[thread_state->thread_id][dec]++;
-		}
-	}
+	getPatternCounts(state, thread_state->thread_id, blocksize, v);
 
 	/*
 	 * Compute the sum of the squares of all the frequencies (needed for step 3)
 	 */
 	sum = 0.0;
 	for (i = 0; i < powLen; i++) {
-		sum += (double) state->serial_v[thread_state->thread_id][i] * (double) state->serial_v[thread_state->thread_id][i];
+		sum += (double) v[i] * (double) v[i];
 	}
 
 	/*
@@ -1171,8 +1105,6 @@ Serial_metrics(struct state *state)
 void
 Serial_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1209,16 +1141,6 @@ Serial_destroy(struct state *state)
 		free(state->subDir[test_num]);
 		state->subDir[test_num] = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->serial_v[i] != NULL) {
-			free(state->serial_v[i]);
-			state->serial_v[i] = NULL;
-		}
-	}
-	if (state->serial_v != NULL) {
-		free(state->serial_v);
-		state->serial_v = NULL;
-	}
 
 	return;
 }
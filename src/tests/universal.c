@@ -79,6 +79,14 @@ static const double variance[MAX_L_UNIVERSAL + 1] = {
 	3.401, 3.410, 3.416, 3.419, 3.421
 };
 
+/*
+ * The log2 of a distance between re-occurrences of the same L-bit block is looked up in state->universal_log2[]
+ * when the distance is less than state->universal_log2_len.  Distances average 2^L blocks, so the table covers
+ * LOG2_TABLE_SPAN times that, up to LOG2_TABLE_MAX_LEN entries.  Larger distances fall back to calling log().
+ */
+#define LOG2_TABLE_SPAN (8)		// Table length in multiples of 2^L
+#define LOG2_TABLE_MAX_LEN (1 << 16)	// Maximum table length
+
 
 /*
  * Forward static function declarations
@@ -199,19 +207,22 @@ Universal_init(struct state *state)
 	p = (long int) 1 << L;
 
 	/*
-	 * Allocate the T table (with block number of the last occurrence of each block) for each thread
+	 * Reserve the T table (with block number of the last occurrence of each block) in the scratch arena of each thread
 	 */
-	state->universal_T = malloc((size_t) state->numberOfThreads * sizeof(*state->universal_T));
-	if (state->universal_T == NULL) {
-		errp(200, __func__, "cannot malloc for universal_T: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->universal_T));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->universal_T[i] = malloc(p * sizeof(state->universal_T[i][0]));
-		if (state->universal_T[i] == NULL) {
-			errp(200, __func__, "cannot malloc of %ld elements of %ld bytes each for state->universal_T[%ld]",
-			     p, sizeof(state->universal_T[i][0]), i);
-		}
+	reserveScratch(state, (size_t) p * sizeof(long int));
+
+	/*
+	 * Fill in the table of log2 of the distances between re-occurrences of a block, shared by all threads
+	 */
+	state->universal_log2_len = MIN(LOG2_TABLE_SPAN * p, LOG2_TABLE_MAX_LEN);
+	state->universal_log2 = malloc(state->universal_log2_len * sizeof(state->universal_log2[0]));
+	if (state->universal_log2 == NULL) {
+		errp(200, __func__, "cannot malloc of %ld elements of %ld bytes each for state->universal_log2",
+		     state->universal_log2_len, sizeof(state->universal_log2[0]));
+	}
+	state->universal_log2[0] = 0.0;	// unused, a distance is always > 0
+	for (i = 1; i < state->universal_log2_len; i++) {
+		state->universal_log2[i] = log(i) / state->c.log2;
 	}
 
 	/*
@@ -265,8 +276,10 @@ Universal_iterate(struct thread_state *thread_state)
 	double p_value;		// p_value iteration test result(s)
 	double c;		// Constant used in the formula of the standard deviation
 	long decRep;		// Decimal representation of a block
+	long int distance;	// Number of blocks since the last occurrence of the same L-bit block
+	WORD64 *packed;		// Packed bit stream of this thread
 	long int i;
-	long int j;
+	struct result_shard *shard;	// Where this thread records the Universal counts, p_value and stats
 
 	/*
 	 * Check preconditions (firewall)
@@ -278,21 +291,22 @@ Universal_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(201, __func__, "state arg is NULL");
 	}
+	if (state->shard == NULL) {
+		err(201, __func__, "state->shard is NULL");
+	}
+	shard = &state->shard[thread_state->thread_id];
 	if (state->testVector[test_num] != true) {
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
-	if (state->epsilon == NULL) {
-		err(201, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(201, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(201, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(201, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
-	if (state->universal_T == NULL) {
-		err(201, __func__, "state->universal_T is NULL");
-	}
-	if (state->universal_T[thread_state->thread_id] == NULL) {
-		err(201, __func__, "state->universal_T[%ld] is NULL", thread_state->thread_id);
+	if (state->universal_log2 == NULL) {
+		err(201, __func__, "state->universal_log2 is NULL");
 	}
 	if (state->cSetup != true) {
 		err(201, __func__, "test constants not setup prior to calling %s for %s[%d]",
@@ -303,7 +317,7 @@ Universal_iterate(struct thread_state *thread_state)
 	 * Collect parameters from state
 	 */
 	L = state->universal_L;
-	T = state->universal_T[thread_state->thread_id];
+	packed = state->packedEpsilon[thread_state->thread_id];
 
 	/*
 	 * Check preconditions (firewall)
@@ -324,6 +338,7 @@ Universal_iterate(struct thread_state *thread_state)
 	stat.Q = 10 * p;
 	stat.K = 100 * stat.Q;
 	stat.sum = 0.0;
+	T = scratchAlloc(thread_state, (size_t) p * sizeof(T[0]));
 	memset(T, 0, p * sizeof(T[0]));	// zeroize T
 
 	/*
@@ -337,10 +352,7 @@ Universal_iterate(struct thread_state *thread_state)
 		 * It is convenient to use this representation because we can store and
 		 * have access to the contents of each block in the table T with size 2^L.
 		 */
-		decRep = 0;
-		for (j = 0; j < L; j++) {
-			decRep += state->epsilon[thread_state->thread_id][(i - 1) * L + j] * ((long int) 1 << (L - 1 - j));
-		}
+		decRep = (long) packedWindow(packed, (i - 1) * L, (int) L);
 
 		/*
 		 * Save the block number of this last occurrence of the this L-bit block in the table.
@@ -357,16 +369,15 @@ Universal_iterate(struct thread_state *thread_state)
 		/*
 		 * Get decimal representation of the block
 		 */
-		decRep = 0;
-		for (j = 0; j < L; j++) {
-			decRep += state->epsilon[thread_state->thread_id][(i - 1) * L + j] * ((long int) 1 << (L - 1 - j));
-		}
+		decRep = (long) packedWindow(packed, (i - 1) * L, (int) L);
 
 		/*
 		 * Add the distance between re-occurrences of the same L-bit block to an
 		 * accumulating log2 sum of all the differences detected in the K blocks
 		 */
-		stat.sum += log(i - T[decRep]) / state->c.log2;
+		distance = i - T[decRep];
+		stat.sum += (distance < state->universal_log2_len) ?
+			state->universal_log2[distance] : log(distance) / state->c.log2;
 
 		/*
 		 * Replace the value in the table with the location of the current block
@@ -387,35 +398,28 @@ Universal_iterate(struct thread_state *thread_state)
 	arg = fabs(stat.f_n - expected_value[L]) / (state->c.sqrt2 * stat.sigma);
 	p_value = erfc(arg);
 
-	/*
-	 * Lock mutex before making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_lock(thread_state->mutex);
-	}
-
 	/*
 	 * Record success or failure for this iteration
 	 */
-	state->count[test_num]++;	// Count this iteration
-	state->valid[test_num]++;	// Count this valid iteration
+	shard->count[test_num]++;	// Count this iteration
+	shard->valid[test_num]++;	// Count this valid iteration
 	if (isNegative(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f < 0.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (isGreaterThanOne(p_value)) {
-		state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
+		shard->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
 		stat.success = false;		// FAILURE
 		warn(__func__, "iteration %ld of test %s[%d] produced bogus p_value: %f > 1.0\n",
 		     thread_state->iteration_being_done + 1, state->testNames[test_num], test_num, p_value);
 	} else if (p_value < state->tp.alpha) {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->failure[test_num]++;	// Valid p_value but too low is a failure
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->failure[test_num]++;	// Valid p_value but too low is a failure
 		stat.success = false;		// FAILURE
 	} else {
-		state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
-		state->success[test_num]++;	// Valid p_value not too low is a success
+		shard->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
+		shard->success[test_num]++;	// Valid p_value not too low is a success
 		stat.success = true;		// SUCCESS
 	}
 
@@ -423,16 +427,9 @@ Universal_iterate(struct thread_state *thread_state)
 	 * Record values computed during this iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
-	}
-	append_value(state->p_val[test_num], &p_value);
-
-	/*
-	 * Unlock mutex after making changes to the shared state
-	 */
-	if (thread_state->mutex != NULL) {
-		pthread_mutex_unlock(thread_state->mutex);
+		append_value(shard->stats[test_num], &stat);
 	}
+	append_value(shard->p_val[test_num], &p_value);
 
 	return;
 }
@@ -1135,8 +1132,6 @@ Universal_metrics(struct state *state)
 void
 Universal_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1173,15 +1168,10 @@ Universal_destroy(struct state *state)
 		free(state->subDir[test_num]);
 		state->subDir[test_num] = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->universal_T[i] != NULL) {
-			free(state->universal_T[i]);
-			state->universal_T[i] = NULL;
-		}
-	}
-	if (state->universal_T != NULL) {
-		free(state->universal_T);
-		state->universal_T = NULL;
+	if (state->universal_log2 != NULL) {
+		free(state->universal_log2);
+		state->universal_log2 = NULL;
+		state->universal_log2_len = 0;
 	}
 
 	return;
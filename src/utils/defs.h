@@ -109,6 +109,7 @@
 #   define BITS_N_BYTE			(8)					// Number of bits in a byte
 #   define BITS_N_INT			(BITS_N_BYTE * sizeof(int))		// Number of bits in an int
 #   define BITS_N_LONGINT		(BITS_N_BYTE * sizeof(long int))	// Number of bits in a long int
+#   define BITS_N_WORD64		(64)					// Number of bits in a WORD64
 #   define MAX_DATA_DIGITS		(21)					// Decimal digits in (2^64)-1
 
 #   define NUMOFTESTS			(15)		// MAX TESTS DEFINED - must match max enum test value below
@@ -242,6 +243,20 @@ enum format {
 	FORMAT_1 = '1',			// Alias for FORMAT_RAW_BINARY - redirects to it
 };
 
+// How randdata is read by the worker threads
+enum read_mode {
+	READ_STDIO = 's',		// Seek and read a shared stdio stream while holding the mutex (default)
+	READ_MMAP = 'm',		// Memory map randdata, each thread copies its own iteration without locking
+	READ_PREAD = 'p',		// Each thread pread()s its own iterations through a private file descriptor
+};
+
+// How thoroughly the fftw library plans the DFT under -W wisdom[,rigor]
+enum plan_rigor {
+	PLAN_ESTIMATE = 'e',		// FFTW_ESTIMATE: use a plan held by the wisdom, else estimate one without measuring
+	PLAN_MEASURE = 'm',		// FFTW_MEASURE: measure a plan unless the wisdom holds one (default with -W)
+	PLAN_PATIENT = 'p',		// FFTW_PATIENT: measure more plans unless the wisdom holds one
+};
+
 // Run modes
 enum run_mode {
 	MODE_ITERATE_AND_ASSESS = 'b',	// Test the data specified from '-g generator' (default mode)
@@ -351,6 +366,104 @@ struct nonover_stats {
 	unsigned int Wj[BLOCKS_NON_OVERLAPPING]; // Number of times that m-bit template occurs within each block
 };
 
+/*
+ * walk - the -1/+1 random walk formed by the bits of an iteration (see getWalk())
+ *
+ * A walk is computed at most once per iteration for each thread, when the first test asks for it,
+ * and is shared by every test that asks for it later in the same iteration.
+ */
+struct walk {
+	bool valid;			// true ==> the walk below was computed from the current iteration
+	long int final;			// Sum of all of the -1/+1 values, i.e., the last partial sum
+	long int max;			// Maximum of 0 and all of the partial sums
+	long int min;			// Minimum of 0 and all of the partial sums
+	/*
+	 * The visits below are only counted if state->walkVisitsNeeded, else they are 0.
+	 * A cycle ends at each partial sum that is 0, and at the last partial sum if it is not 0.
+	 * States are indexed as in state->rnd_excursion_stateX and state->rnd_excursion_var_stateX.
+	 */
+	long int zeros;			// Number of partial sums that are 0
+	long int visits[NUMBER_OF_STATES_RND_EXCURSION_VAR];	// Number of partial sums equal to each state
+	long int cycles[DEGREES_OF_FREEDOM_RND_EXCURSION][NUMBER_OF_STATES_RND_EXCURSION];	// cycles[k][x]: number of
+						// cycles that visit state x k times (or at least k times for the last k)
+	long int lastCycle[NUMBER_OF_STATES_RND_EXCURSION];	// Number of visits to each state in the last cycle
+};
+
+/*
+ * patterns - the overlapping patterns of an iteration, with the bits read cyclically (see getPatternCounts())
+ *
+ * The patterns are counted at most once per iteration for each thread, when the first test asks for them,
+ * at the widest width state->patternWidth any enabled test needs.  Narrower widths are derived from them.
+ */
+struct patterns {
+	bool valid;			// true ==> count below was computed from the current iteration
+	long int *count;		// count[x]: number of the n cyclic windows of state->patternWidth bits that equal x
+};
+
+/*
+ * scratch_arena - the working storage of a test thread for the test it is running (see scratchAlloc())
+ *
+ * The init function of each test reserves what its iterate function will take (see reserveScratch()),
+ * so that every test thread allocates one block of state->scratchSize bytes up front.  The arena is
+ * emptied before each test of an iteration, so the tests take their working buffers without calling
+ * malloc(), and one block sized for the largest test serves all of them.
+ */
+#   define SCRATCH_ALIGN	(64)		// Alignment of each chunk taken from a scratch arena
+
+struct scratch_arena {
+	BYTE *base;			// SCRATCH_ALIGN aligned storage of state->scratchSize bytes
+	size_t used;			// Bytes taken from base since the start of the current test
+};
+
+/*
+ * result_shard - the results recorded by one test thread during the iterate phase (see mergeResultShards())
+ *
+ * Each test thread counts and appends the results of the tests it ran to its own shard, without locking.
+ * After all of the test threads are joined, the shards are merged into the counters and arrays of the state,
+ * where the values of each iteration are put in the slots of that iteration, whichever thread did it.
+ */
+struct result_shard {
+	long int count[NUMOFTESTS + 1];		// Count of completed iterations, including tests skipped due to conditions
+	long int valid[NUMOFTESTS + 1];		// Count of completed testable iterations
+	long int success[NUMOFTESTS + 1];	// Count of completed SUCCESS iterations that were testable
+	long int failure[NUMOFTESTS + 1];	// Count of completed FAILURE iterations that were testable
+	long int valid_p_val[NUMOFTESTS + 1];	// Count of p_values that were [0.0, 1.0] for iterations that were testable
+	struct dyn_array *stats[NUMOFTESTS + 1];// Per test per iteration data, like state->stats, or NULL
+	struct dyn_array *p_val[NUMOFTESTS + 1];// Per test p_values, like state->p_val, or NULL
+	struct dyn_array *iterations[NUMOFTESTS + 1];// Per test iteration_being_done of each iteration it did, in order
+};
+
+/*
+ * block_range - a share of the independent blocks of one iteration (see runBlocks())
+ *
+ * Each of the state->blockThreads shares of an iteration is worked on by one test thread, which
+ * uses the scratch storage of its worker slot and leaves its counters in result for the caller to merge.
+ * Share 0 is worked on by the test thread running the iteration, the others by whichever test thread
+ * takes them from the task graph first.
+ */
+struct block_range {
+	struct thread_state *thread_state;	// Thread that is running the iteration
+	long int worker;			// Index of this share, 0 thru state->blockThreads - 1
+	long int slot;				// Scratch storage slot: thread_id * state->blockThreads + worker
+	long int first;				// First block of this share
+	long int count;				// Number of blocks in this share
+	void *result;				// Counters of this share
+	void (*work)(struct block_range *range);	// Function that works on the blocks of this share
+};
+
+/*
+ * block_shares - shares of the blocks of the iteration that one test thread is running (see runBlocks())
+ *
+ * The test thread keeps share 0 and publishes the others on its task graph, where idle test threads
+ * take them (see nextTask()).  Once done with share 0 it works on the published shares that are left,
+ * then waits on done until every share taken by another thread is finished.
+ */
+struct block_shares {
+	struct block_range *range;	// Shares of the current iteration, state->blockThreads of them
+	long int pending;		// Number of published shares not yet finished, guarded by the task graph lock
+	pthread_cond_t done;		// Signaled, under the task graph lock, when pending drops to 0
+};
+
 /*
  * Struct representing a node of the filenames linked-list
  */
@@ -396,8 +509,27 @@ struct state {
 	bool dataFormatFlag;		// true if -F format was given
 	enum format dataFormat;		// -F format: 'r': raw binary, 'a': ASCII '0'/'1' chars
 
+	bool readModeFlag;		// true if -R readMode was given
+	enum read_mode readMode;	// -R readMode: 's': shared stdio stream, 'm': memory mapped randdata,
+					//		'p': per thread positional reads
+
+	bool prefetchFlag;		// true if -Q depth[,readers] was given
+	long int prefetchDepth;		// -Q depth: number of iterations read ahead of the workers (0 ==> no prefetch)
+	long int prefetchReaders;	// -Q depth,readers: number of reader threads filling the prefetch ring
+
+	bool wisdomFlag;		// true if -W wisdom[,rigor] was given
+	char *wisdomPath;		// -W wisdom: FFTW wisdom file for TEST_DFT, relative paths are under workDir
+	enum plan_rigor wisdomRigor;	// -W wisdom,rigor: 'e': estimate, 'm': measure, 'p': patient
+	char *wisdomFilename;		// Path of the wisdom file, formed from wisdomPath by TEST_DFT, or NULL
+
+	bool pinThreadsFlag;		// true if -N was given: pin test threads to CPUs of a NUMA node (Linux only)
+
+	char *overlappingTemplate;	// -B template: bits of the TEST_OVERLAPPING template, or NULL for m 1 bits
+
 	bool numberOfThreadsFlag;	// true if -T numberOfFlag was given
 	long int numberOfThreads;	// Number of threads to use for the current execution
+	long int blockThreads;		// Shares into which an iteration may split its independent blocks (see runBlocks())
+	long int fftwThreads;		// Threads with which the fftw library computes each DFT of TEST_DFT
 	long int iterationsMissing;	// Number of iterations that need to be completed
 
 	bool jobnumFlag;		// true if -j jobnum was given
@@ -415,6 +547,8 @@ struct state {
 	bool cSetup;			// true --> init() function has initialized the test constants c
 
 	FILE *streamFile;		// true if non-NULL, open stream for randomDataPath
+	BYTE *mappedData;		// true if non-NULL, read-only memory map of randomDataPath for -R m
+	size_t mappedLength;		// Length in bytes of the mappedData memory map
 	char *finalReptPath;		// true if non-NULL, path of the final results file
 	FILE *finalRept;		// true if non-NULL, open stream for the final results file
 	char *freqFilePath;		// true if non-NULL, path of freq.txt
@@ -431,14 +565,21 @@ struct state {
 
 	bool is_excursion[NUMOFTESTS + 1];	// true --> test is a form of random excursion
 
-	BitSequence **epsilon;			// Bit stream
 	BitSequence *tmpepsilon;		// Buffer to write to file in dataFormat
+	WORD64 **packedEpsilon;			// Bit stream packed BITS_N_WORD64 bits per word (see packBytes())
+	struct walk *walk;			// Per thread random walk of the current iteration (see getWalk())
+	bool walkVisitsNeeded;			// true ==> an enabled test needs the excursion state visits of the random walk
+	struct patterns *patterns;		// Per thread overlapping patterns of the current iteration (see getPatternCounts())
+	long int patternWidth;			// Widest overlapping pattern an enabled test needs, 0 ==> none
+	struct scratch_arena *scratch;		// Per thread working storage of the current iteration (see scratchAlloc())
+	size_t scratchSize;			// Largest scratch arena reservation of an enabled test, in bytes
 
 	long int count[NUMOFTESTS + 1];		// Count of completed iterations, including tests skipped due to conditions
 	long int valid[NUMOFTESTS + 1];		// Count of completed testable iterations, ignores tests skipped due to conditions
 	long int success[NUMOFTESTS + 1];	// Count of completed SUCCESS iterations that were testable
 	long int failure[NUMOFTESTS + 1];	// Count of completed FAILURE iterations that were testable
 	long int valid_p_val[NUMOFTESTS + 1];	// Count of p_values that were [0.0, 1.0] for iterations that were testable
+	struct result_shard *shard;		// Per test thread results of the iterate phase (see mergeResultShards())
 
 	struct metric_results metric_results;	// Results of the final metric tests on every test
 	long int successful_tests;		// Number of tests who passed both proportion and uniformity tests
@@ -449,48 +590,122 @@ struct state {
 
 	struct dyn_array *nonovTemplates;	// Array of non-overlapping template words for TEST_NON_OVERLAPPING
 
-	double **fft_m;				// test m array for TEST_DFT
-	double **fft_X;				// test X array for TEST_DFT
-# if defined(LEGACY_FFT)
-	double **fft_wsave;			// test wsave array for legacy dfft library in TEST_DFT
-#else /* LEGACY_FFT */
-	fftw_plan *fftw_p;			// Plan containing information about the fastest way to compute the transform
-	fftw_complex **fftw_out;		// Output array for fftw library output in TEST_DFT
+#if !defined(LEGACY_FFT)
+	fftw_plan fftw_p;			// Plan containing information about the fastest way to compute the transform,
+						// shared by all threads through fftw_execute_dft_r2c()
 #endif /* LEGACY_FFT */
 
-	BitSequence ***rank_matrix;		// Rank test 32 by 32 matrix for TEST_RANK
+	WORD64 **rank_matrix;			// Per share of each thread, 32 by 32 matrix of packed rows (in the scratch arena) for TEST_RANK
 
 	long int *rnd_excursion_var_stateX;	// Pointer to NUMBER_OF_STATES_RND_EXCURSION_VAR states for TEST_RND_EXCURSION_VAR
-	long int **ex_var_partial_sums;		// Array of n partial sums for TEST_RND_EXCURSION_VAR
 
-	BitSequence **linear_b;			// LFSR array b for TEST_LINEARCOMPLEXITY
-	BitSequence **linear_c;			// LFSR array c for TEST_LINEARCOMPLEXITY
-	BitSequence **linear_t;			// LFSR array t for TEST_LINEARCOMPLEXITY
+	WORD64 **linear_b;			// Per share of each thread, packed LFSR polynomial b (in the scratch arena) for TEST_LINEARCOMPLEXITY
+	WORD64 **linear_c;			// Per share of each thread, packed LFSR polynomial c (in the scratch arena) for TEST_LINEARCOMPLEXITY
+	WORD64 **linear_t;			// Per share of each thread, packed LFSR polynomial t (in the scratch arena) for TEST_LINEARCOMPLEXITY
 
-	long int **apen_C;			// Frequency count for TEST_APEN
-	long int apen_C_len;			// Number of long ints in apen_C for TEST_APEN
+	long int apen_C_len;			// Number of long ints in the frequency count C of TEST_APEN
 
-	long int **serial_v;			// Frequency count for TEST_SERIAL
-	long int serial_v_len;			// Number of long ints in serial_v for TEST_SERIAL
+	long int serial_v_len;			// Number of long ints in the frequency count v of TEST_SERIAL
 
-	BitSequence **nonper_seq;		// Special BitSequence for TEST_NON_OVERLAPPING
+	long int *nonovTemplateIndex;		// Template index of each m bit window, or -1, for TEST_NON_OVERLAPPING
+	long int **nonovNextMatch;		// Per share of each thread, first position where each template may match for TEST_NON_OVERLAPPING
 
 	long int universal_L;			// Length of each block for TEST_UNIVERSAL
-	long int **universal_T;			// Working Universal template
+	double *universal_log2;			// universal_log2[d] is log(d) / log(2) for distances d < universal_log2_len
+	long int universal_log2_len;		// Number of entries in universal_log2 for TEST_UNIVERSAL
 
-	long int **rnd_excursion_S;		// Sum of -1/+1 states for TEST_RND_EXCURSION
-	struct dyn_array **rnd_excursion_cycle;	// Contains the index of the ending position of each cycle for TEST_RND_EXCURSION
 	long int *rnd_excursion_stateX;		// Pointer to NUMBER_OF_STATES_RND_EXCURSION states for TEST_RND_EXCURSION_VAR
 	double **rnd_excursion_pi_terms;	// Theoretical probabilities for states of TEST_RND_EXCURSION_VAR
 
 	bool legacy_output;			// true ==> try to mimic output format of legacy code
 };
 
+/*
+ * prefetch_ring - bounded queue of iterations read ahead of the worker threads (-Q depth[,readers])
+ *
+ * The ring owns depth spare packed bit buffers.  Reader threads fill empty buffers with the next iteration
+ * and queue them as full.  A worker takes the oldest full buffer in exchange for the packed bit buffer
+ * it has just finished testing, so no bits are ever copied between buffers.
+ */
+struct prefetch_ring {
+	long int depth;			// Number of spare packed bit buffers owned by the ring
+	long int readersActive;		// Number of reader threads that have not yet finished
+	WORD64 **full;			// Circular queue of filled buffers, oldest first
+	long int *fullIteration;	// Iteration held by each buffer in full
+	long int fullHead;		// Index in full of the oldest filled buffer
+	long int fullCount;		// Number of filled buffers waiting for a worker
+	WORD64 **empty;			// Stack of buffers waiting to be filled
+	long int emptyCount;		// Number of buffers waiting to be filled
+	long int workerWaits;		// Number of times a worker found no filled buffer
+	long int readerWaits;		// Number of times a reader found no buffer to fill
+	pthread_mutex_t lock;		// Guards all of the above
+	pthread_cond_t notEmpty;	// Signaled when a buffer is filled or when the last reader finishes
+	pthread_cond_t notFull;		// Signaled when a buffer is returned to be filled
+};
+
+/*
+ * loaded_iteration - packed bits of one iteration, shared by the tasks that test it (see task_graph)
+ */
+struct loaded_iteration {
+	long int iteration;		// Iteration held in bits
+	WORD64 *bits;			// Packed bit stream of the iteration, PACKED_WORDS(state->tp.n) words
+	long int pending;		// Number of tests of the iteration not yet done, bits are reused once 0
+};
+
+/*
+ * test_task - one enabled test to run on one loaded iteration
+ */
+struct test_task {
+	struct loaded_iteration *loaded;	// Iteration to test
+	int test;				// Test to run on it
+};
+
+/*
+ * task_graph - (iteration, test) tasks shared among the test threads by work stealing
+ *
+ * Each task depends only on its iteration being loaded.  A test thread with no task of its own loads the next
+ * iteration into a free buffer and queues a task for each enabled test on its own deque, from which it takes
+ * them in test order.  A thread that has neither a task of its own nor a free buffer to load steals the oldest
+ * task queued by another thread.  The buffer of an iteration is counted by its pending tests, and goes back
+ * to the free buffers when the last of them is done.  The block shares that a running test publishes with
+ * runBlocks() are taken before anything else, so idle threads help with the slow tests of the last iterations.
+ */
+struct task_graph {
+	long int threads;		// Number of test threads, each with its own deque
+	struct test_task **deque;	// deque[i]: circular deque of the tasks queued by test thread i
+	long int *head;			// head[i]: index in deque[i] of its oldest task
+	long int *count;		// count[i]: number of tasks in deque[i]
+	long int capacity;		// Number of tasks each deque can hold
+	long int queued;		// Number of tasks in all of the deques
+	int tests[NUMOFTESTS];		// Enabled tests, in test order
+	int testCount;			// Number of enabled tests, i.e., tasks per iteration
+	struct loaded_iteration *loaded;	// Iteration buffers, maxLoaded of them
+	long int maxLoaded;		// Number of iteration buffers, i.e., most iterations being tested at once
+	struct loaded_iteration **free;	// Stack of buffers waiting for an iteration
+	long int freeCount;		// Number of buffers in free
+	long int loading;		// Number of threads loading an iteration
+	bool exhausted;			// true ==> every iteration has been loaded
+	struct block_range **share;	// Stack of the block shares published by runBlocks() that no thread has taken
+	long int shareCount;		// Number of block shares in share
+	long int running;		// Number of tasks being run
+	long int steals;		// Number of tasks taken from the deque of another thread
+	long int shareSteals;		// Number of block shares worked on by a thread other than their owner
+	long int waits;			// Number of times a thread found nothing to do
+	pthread_mutex_t lock;		// Guards all of the above, except the bits of the loaded iterations
+	pthread_cond_t wake;		// Signaled when work is queued, a buffer is freed, all are loaded or none is running
+};
+
 struct thread_state {
 	long int thread_id;
 	struct state *global_state;
 	long int iteration_being_done;
 	pthread_mutex_t *mutex;
+	int inputFd;			// -R p: private file descriptor open on randomDataPath, or -1
+	BYTE *inputBuf;			// -R p: bytes of the current iteration as read from inputFd
+	struct prefetch_ring *ring;	// -Q depth: ring of iterations read ahead, or NULL
+	struct block_shares *blocks;	// Shares of the blocks of an iteration, or NULL if state->blockThreads is 1
+	struct task_graph *graph;	// Tasks shared among the test threads, or NULL for a prefetch reader thread
+	long int cachedIteration;	// Iteration of the walk and patterns of this thread, or -1
 };
 
 /* *INDENT-ON* */
@@ -499,7 +714,7 @@ struct thread_state {
  * Driver - a driver like API to setup a given test, iterate on bitstreams, analyze test results
  */
 extern void init(struct state *state);
-extern void iterate(struct thread_state *thread_state);
+extern void iterate(struct thread_state *thread_state, int test);
 extern void print(struct state *state);
 extern void metrics(struct state *state);
 extern void destroy(struct state *state);
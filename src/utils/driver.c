@@ -206,6 +206,7 @@ void
 init(struct state *state)
 {
 	int test_count;		// Number of tests enabled after initialization
+	size_t scratchSize;	// Largest scratch arena reservation of an enabled test
 	int i;
 
 	/*
@@ -322,12 +323,19 @@ init(struct state *state)
 
 	/*
 	 * Initialize all active tests
+	 *
+	 * NOTE: A test thread empties its scratch arena before each test, so the arena only needs to hold
+	 *	 the largest reservation that a single test makes with reserveScratch().
 	 */
+	scratchSize = 0;
 	for (i = 1; i <= NUMOFTESTS; i++) {
 		if (state->testVector[i] == true && testDriver[i].init != NULL) {
+			state->scratchSize = 0;
 			testDriver[i].init(state);
+			scratchSize = MAX(scratchSize, state->scratchSize);
 		}
 	}
+	state->scratchSize = scratchSize;
 
 	/*
 	 * Some tests may have disabled themselves, be sure we have at least one enabled test
@@ -358,25 +366,56 @@ init(struct state *state)
 	state->iterationsMissing = state->tp.numOfBitStreams;
 
 	/*
-	 * Allocate the array for the bit streams copied to memory
+	 * Allocate the packed bit stream slot of each test thread
+	 *
+	 * NOTE: The slot of a test thread points to the buffer of the iteration it is testing, which belongs to
+	 *	 the task graph (see createTaskGraph()), so no buffer is allocated here.  Under -Q depth[,readers],
+	 *	 each prefetch reader thread also has a slot after those of the test threads.  It points to the
+	 *	 ring buffer that the reader is currently filling.
+	 */
+	state->packedEpsilon = calloc((size_t) (state->numberOfThreads + state->prefetchReaders), sizeof(*state->packedEpsilon));
+	if (state->packedEpsilon == NULL) {
+		errp(50, __func__, "cannot calloc for packedEpsilon: %ld elements of %lu bytes each",
+		     state->numberOfThreads + state->prefetchReaders, sizeof(*state->packedEpsilon));
+	}
+
+	/*
+	 * Allocate the random walk of each test thread
+	 *
+	 * NOTE: The test init functions above set state->walkVisitsNeeded when an enabled test needs the state visits.
 	 */
-	state->epsilon = calloc((size_t) state->numberOfThreads, sizeof(*state->epsilon));
-	if (state->epsilon == NULL) {
-		errp(50, __func__, "cannot calloc for epsilon: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->epsilon));
+	state->walk = calloc((size_t) state->numberOfThreads, sizeof(*state->walk));
+	if (state->walk == NULL) {
+		errp(50, __func__, "cannot calloc for walk: %ld elements of %lu bytes each",
+		     state->numberOfThreads, sizeof(*state->walk));
 	}
 
 	/*
-	 * Allocate the array for the bit stream copied to memory for each thread
+	 * Allocate the overlapping pattern counts of each test thread
+	 *
+	 * NOTE: The test init functions above set state->patternWidth to the widest pattern an enabled test needs.
 	 */
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->epsilon[i] = calloc((size_t) state->tp.n, sizeof(BitSequence));
-		if (state->epsilon == NULL) {
-			errp(50, __func__, "cannot calloc for epsilon[%d]: %ld elements of %lu bytes each", i,
-			     state->tp.n, sizeof(BitSequence));
+	state->patterns = calloc((size_t) state->numberOfThreads, sizeof(*state->patterns));
+	if (state->patterns == NULL) {
+		errp(50, __func__, "cannot calloc for patterns: %ld elements of %lu bytes each",
+		     state->numberOfThreads, sizeof(*state->patterns));
+	}
+	for (i = 0; state->patternWidth > 0 && i < state->numberOfThreads; i++) {
+		state->patterns[i].count = malloc(((size_t) 1 << state->patternWidth) * sizeof(state->patterns[i].count[0]));
+		if (state->patterns[i].count == NULL) {
+			errp(50, __func__, "cannot malloc for patterns[%d].count: %ld elements of %lu bytes each", i,
+			     (long int) 1 << state->patternWidth, sizeof(state->patterns[i].count[0]));
 		}
 	}
 
+	/*
+	 * Allocate the scratch arena of each test thread
+	 *
+	 * NOTE: The test init functions above reserved what their iterate functions take, and
+	 *	 state->scratchSize is the largest of those reservations.
+	 */
+	createScratch(state);
+
 	/*
 	 * Report the end of the init phase
 	 */
@@ -387,16 +426,15 @@ init(struct state *state)
 
 
 /*
- * iterate - perform a single run of all the enabled tests on a bitstream
+ * iterate - perform a single run of one enabled test on a bitstream
  *
  * given:
- *      state           // current processing state
+ *      thread_state    // state of the test thread, holding the bitstream in its packed bit stream
+ *      test            // test to run
  */
 void
-iterate(struct thread_state *thread_state)
+iterate(struct thread_state *thread_state, int test)
 {
-	int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -407,18 +445,15 @@ iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(51, __func__, "state is NULL");
 	}
+	if (test < 1 || test > NUMOFTESTS) {
+		err(51, __func__, "test: %d must be in the range [1-%d]", test, NUMOFTESTS);
+	}
 
 	/*
-	 * Perform an iteration for each test on the current bitstream
+	 * Call test iterate function if the test is enabled
 	 */
-	for (i = 1; i <= NUMOFTESTS; ++i) {
-
-		/*
-		 * Call test iterate function if the test is enabled
-		 */
-		if (state->testVector[i] == true && testDriver[i].iterate != NULL) {
-			testDriver[i].iterate(thread_state);
-		}
+	if (state->testVector[test] == true && testDriver[test].iterate != NULL) {
+		testDriver[test].iterate(thread_state);
 	}
 
 	return;
@@ -1216,19 +1251,55 @@ destroy(struct state *state)
 		free(state->workDir);
 		state->workDir = NULL;
 	}
+	if (state->wisdomPath != NULL) {
+		free(state->wisdomPath);
+		state->wisdomPath = NULL;
+	}
+	if (state->wisdomFilename != NULL) {
+		free(state->wisdomFilename);
+		state->wisdomFilename = NULL;
+	}
+	if (state->overlappingTemplate != NULL) {
+		free(state->overlappingTemplate);
+		state->overlappingTemplate = NULL;
+	}
 	if (state->tmpepsilon != NULL) {
 		free(state->tmpepsilon);
 		state->tmpepsilon = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->epsilon[i] != NULL) {
-			free(state->epsilon[i]);
-			state->epsilon[i] = NULL;
+	for (i = 0; state->packedEpsilon != NULL && i < state->numberOfThreads + state->prefetchReaders; i++) {
+		if (state->packedEpsilon[i] != NULL) {
+			free(state->packedEpsilon[i]);
+			state->packedEpsilon[i] = NULL;
+		}
+	}
+	if (state->packedEpsilon != NULL) {
+		free(state->packedEpsilon);
+		state->packedEpsilon = NULL;
+	}
+	if (state->walk != NULL) {
+		free(state->walk);
+		state->walk = NULL;
+	}
+	for (i = 0; state->patterns != NULL && i < state->numberOfThreads; i++) {
+		if (state->patterns[i].count != NULL) {
+			free(state->patterns[i].count);
+			state->patterns[i].count = NULL;
+		}
+	}
+	if (state->patterns != NULL) {
+		free(state->patterns);
+		state->patterns = NULL;
+	}
+	for (i = 0; state->scratch != NULL && i < state->numberOfThreads; i++) {
+		if (state->scratch[i].base != NULL) {
+			free(state->scratch[i].base);
+			state->scratch[i].base = NULL;
 		}
 	}
-	if (state->epsilon != NULL) {
-		free(state->epsilon);
-		state->epsilon = NULL;
+	if (state->scratch != NULL) {
+		free(state->scratch);
+		state->scratch = NULL;
 	}
 	if (state->freqFilePath != NULL) {
 		free(state->freqFilePath);
@@ -31,153 +31,75 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../utils/externs.h"
+#include "utilities.h"
 #include "matrix.h"
 #include "debug.h"
 
 
-#define	MATRIX_FORWARD_ELIMINATION	0
-#define	MATRIX_BACKWARD_ELIMINATION	1
-
-// static declaratione
-static void perform_elementary_row_operations(int flag, int i, int M, int Q, BitSequence ** A);
-static int find_unit_element_and_swap(int flag, int i, int M, int Q, BitSequence ** A);
-static int swap_rows(int index_first_row, int index_second_row, int Q, BitSequence ** A);
-static int determine_rank(int m, int M, int Q, BitSequence ** A);
-
-
+/*
+ * computeRank - determine the rank over GF(2) of a matrix of packed rows
+ *
+ * given:
+ *      M       // Number of rows in the matrix
+ *      Q       // Number of columns in each matrix row
+ *      matrix  // M rows of MATRIX_ROW_WORDS(Q) words each, as filled by def_matrix()
+ *
+ * returns:
+ *      rank of the matrix
+ *
+ * Rows are reduced in place by Gaussian elimination.  Each non-zero row, in turn, becomes the
+ * pivot for its leading 1 bit, found by counting leading zeros, and is XORed a word at a time into
+ * every later row that has that bit set.  Since no later row keeps a 1 in an earlier pivot column,
+ * the non-zero rows left are linearly independent and their count is the rank.
+ */
 int
-computeRank(int M, int Q, BitSequence **matrix)
+computeRank(int M, int Q, WORD64 *matrix)
 {
+	WORD64 *pivot;		// Row whose leading 1 bit is being eliminated from later rows
+	WORD64 *row;		// A later row
+	WORD64 bit;		// Leading 1 bit of the pivot row within word w
+	int words;		// Number of words in a row
+	int rank;		// Number of pivot rows found
+	int w;			// Index of the word holding the leading 1 bit of the pivot row
 	int i;
-	int rank;
-	int m = MIN(M, Q);
-
-	/*
-	 * Forward application of elementary row operations
-	 */
-	for (i = 0; i < m - 1; i++) {
-		if (matrix[i][i] == 1) {
-			perform_elementary_row_operations(MATRIX_FORWARD_ELIMINATION, i, M, Q, matrix);
-		} else if (matrix[i][i] == 0) {
-			if (find_unit_element_and_swap(MATRIX_FORWARD_ELIMINATION, i, M, Q, matrix) == 1) {
-				perform_elementary_row_operations(MATRIX_FORWARD_ELIMINATION, i, M, Q, matrix);
-			}
-		} else {
-			err(122, __func__, "matrix[%d][%d] == %u (should contain 1 or 0).", i, i, matrix[i][i]);
-		}
-	}
-
-	/*
-	 * Backward application of elementary row operations
-	 */
-	for (i = m - 1; i > 0; i--) {
-		if (matrix[i][i] == 1) {
-			perform_elementary_row_operations(MATRIX_BACKWARD_ELIMINATION, i, M, Q, matrix);
-		} else if (matrix[i][i] == 0) {
-			if (find_unit_element_and_swap(MATRIX_BACKWARD_ELIMINATION, i, M, Q, matrix) == 1) {
-				perform_elementary_row_operations(MATRIX_BACKWARD_ELIMINATION, i, M, Q, matrix);
-			}
-		} else {
-			err(122, __func__, "matrix[%d][%d] == %u (should contain 1 or 0).", i, i, matrix[i][i]);
-		}
-	}
-
-	rank = determine_rank(m, M, Q, matrix);
-
-	return rank;
-}
-
-static void
-perform_elementary_row_operations(int flag, int i, int M, int Q, BitSequence ** A)
-{
 	int j;
 	int k;
 
-	if (flag == MATRIX_FORWARD_ELIMINATION) {
-		for (j = i + 1; j < M; j++) {
-			if (A[j][i] == 1) {
-				for (k = i; k < Q; k++) {
-					A[j][k] = (BitSequence) ((A[j][k] + A[i][k]) % 2);
-				}
-			}
-		}
-	} else {
-		for (j = i - 1; j >= 0; j--) {
-			if (A[j][i] == 1) {
-				for (k = 0; k < Q; k++) {
-					A[j][k] = (BitSequence) ((A[j][k] + A[i][k]) % 2);
-				}
-			}
-		}
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (matrix == NULL) {
+		err(122, __func__, "matrix arg is NULL");
 	}
-}
 
-static int
-find_unit_element_and_swap(int flag, int i, int M, int Q, BitSequence ** A)
-{
-	int index;
-	int row_op = 0;
+	words = MATRIX_ROW_WORDS(Q);
+	rank = 0;
+	for (i = 0; i < M; i++) {
 
-	if (flag == MATRIX_FORWARD_ELIMINATION) {
-		index = i + 1;
-		while ((index < M) && (A[index][i] == 0)) {
-			index++;
-		}
-		if (index < M) {
-			row_op = swap_rows(i, index, Q, A);
+		/*
+		 * Find the leading 1 bit of this row, if any
+		 */
+		pivot = matrix + i * words;
+		for (w = 0; w < words && pivot[w] == 0; w++) {
+			;
 		}
-	} else {
-		index = i - 1;
-		while ((index >= 0) && (A[index][i] == 0)) {
-			index--;
+		if (w == words) {
+			continue;
 		}
-		if (index >= 0) {
-			row_op = swap_rows(i, index, Q, A);
-		}
-	}
+		bit = (WORD64) 1 << (BITS_N_WORD64 - 1 - __builtin_clzll(pivot[w]));
+		rank++;
 
-	return row_op;
-}
-
-static int
-swap_rows(int index_first_row, int index_second_row, int Q, BitSequence ** A)
-{
-	int p;
-	BitSequence temp;
-
-	for (p = 0; p < Q; p++) {
-		temp = A[index_first_row][p];
-		A[index_first_row][p] = A[index_second_row][p];
-		A[index_second_row][p] = temp;
-	}
-
-	return 1;
-}
-
-static int
-determine_rank(int m, int M, int Q, BitSequence ** A)
-{
-	int i;
-	int j;
-	int rank;
-	int allZeroes;
-
-	/*
-	 * DETERMINE RANK, THAT IS, COUNT THE NUMBER OF NONZERO ROWS
-	 */
-
-	rank = m;
-	for (i = 0; i < M; i++) {
-		allZeroes = 1;
-		for (j = 0; j < Q; j++) {
-			if (A[i][j] == 1) {
-				allZeroes = 0;
-				break;
+		/*
+		 * Clear that bit from all later rows
+		 */
+		for (j = i + 1; j < M; j++) {
+			row = matrix + j * words;
+			if (row[w] & bit) {
+				for (k = w; k < words; k++) {
+					row[k] ^= pivot[k];
+				}
 			}
 		}
-		if (allZeroes == 1) {
-			rank--;
-		}
 	}
 
 	return rank;
@@ -185,25 +107,24 @@ determine_rank(int m, int M, int Q, BitSequence ** A)
 
 
 /*
- * create_matrix - allocate a 2D matrix of BitSequence values
+ * create_matrix - allocate a matrix of packed rows
  *
  * given:
  *      M       // Number of rows in the matrix
  *      Q       // Number of columns in each matrix row
  *
  * returns:
- *      An allocated 2D matrix of BitSequence values.
+ *      An allocated matrix of M rows of MATRIX_ROW_WORDS(Q) words each.
  *
  * NOTE: This function does NOT return on error.
  *
  * NOTE: Unlike older versions of this function, create_matrix()
  *       does not zeroize the matrix.
  */
-BitSequence **
+WORD64 *
 create_matrix(int M, int Q)
 {
-	BitSequence **matrix;	// matrix top return
-	int i;
+	WORD64 *matrix;		// matrix top return
 
 	/*
 	 * Check preconditions (firewall)
@@ -216,23 +137,12 @@ create_matrix(int M, int Q)
 	}
 
 	/*
-	 * Allocate array of matrix rows
+	 * Allocate the rows of the matrix
 	 */
-	matrix = malloc(M * sizeof(matrix[0]));
+	matrix = malloc((size_t) M * MATRIX_ROW_WORDS(Q) * sizeof(matrix[0]));
 	if (matrix == NULL) {
 		errp(120, __func__, "cannot malloc of %ld elements of %ld bytes each for matrix rows",
-		     (long int) M, sizeof(BitSequence *));
-	}
-
-	/*
-	 * Allocate the columns for each matrix row
-	 */
-	for (i = 0; i < M; i++) {
-		matrix[i] = malloc(Q * sizeof(matrix[0][0]));
-		if (matrix[i] == NULL) {
-			errp(120, __func__, "cannot malloc of %ld elements of %ld bytes each for matrix[%d] column",
-			     (long int) Q, sizeof(BitSequence), i);
-		}
+		     (long int) M * MATRIX_ROW_WORDS(Q), sizeof(matrix[0]));
 	}
 
 	return matrix;
@@ -246,12 +156,19 @@ create_matrix(int M, int Q)
  * given:
  *      M       // Number of rows in the matrix m
  *      Q       // Number of columns in each row of the matrix m
- *      m       // allocated 2D matrix of BitSequence values
+ *      m       // allocated matrix of packed rows
  *      k       // offset for the bits to copy to this matrix (counts the matrices that were already filled)
+ *
+ * Rows are taken a word at a time from the packed bit stream.  The first bit of a row is the most
+ * significant bit of its first word, and bits past Q at the end of a row are 0.
  */
 void
-def_matrix(struct thread_state *thread_state, int M, int Q, BitSequence ** m, long int k)
+def_matrix(struct thread_state *thread_state, int M, int Q, WORD64 *m, long int k)
 {
+	WORD64 *packed;		// Packed bit stream of this thread
+	long int start;		// Position of the first bit of the row in the sequence
+	int words;		// Number of words in a row
+	int bits;		// Number of bits of the row held by a word
 	int i;
 	int j;
 
@@ -265,11 +182,11 @@ def_matrix(struct thread_state *thread_state, int M, int Q, BitSequence ** m, lo
 	if (state == NULL) {
 		err(121, __func__, "state arg is NULL");
 	}
-	if (state->epsilon == NULL) {
-		err(121, __func__, "state->epsilon is NULL");
+	if (state->packedEpsilon == NULL) {
+		err(121, __func__, "state->packedEpsilon is NULL");
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(121, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
 	}
 	if (M < 0) {
 		err(121, __func__, "number of rows: %d must be > 0", M);
@@ -280,10 +197,14 @@ def_matrix(struct thread_state *thread_state, int M, int Q, BitSequence ** m, lo
 	if (k < 0) {
 		err(121, __func__, "offset for the values to copy from the sequence to to m: %d must be > 0", Q);
 	}
+	packed = state->packedEpsilon[thread_state->thread_id];
 
+	words = MATRIX_ROW_WORDS(Q);
 	for (i = 0; i < M; i++) {
-		for (j = 0; j < Q; j++) {
-			m[i][j] = state->epsilon[thread_state->thread_id][k * (M * Q) + j + i * M];
+		start = k * (M * Q) + i * Q;
+		for (j = 0; j < words; j++) {
+			bits = MIN(Q - j * BITS_N_WORD64, BITS_N_WORD64);
+			m[i * words + j] = packedWindow(packed, start + j * BITS_N_WORD64, bits) << (BITS_N_WORD64 - bits);
 		}
 	}
 }
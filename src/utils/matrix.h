@@ -30,8 +30,10 @@
 
 #include "../utils/defs.h"
 
-extern int computeRank(int M, int Q, BitSequence ** matrix);
-extern BitSequence **create_matrix(int M, int Q);
-extern void def_matrix(struct thread_state *thread_state, int M, int Q, BitSequence ** m, long int k);
+#   define MATRIX_ROW_WORDS(Q)	(((Q) + BITS_N_WORD64 - 1) / BITS_N_WORD64)	// Words holding a row of Q bits
+
+extern int computeRank(int M, int Q, WORD64 *matrix);
+extern WORD64 *create_matrix(int M, int Q);
+extern void def_matrix(struct thread_state *thread_state, int M, int Q, WORD64 *m, long int k);
 
 #endif				/* MATRIX_H */
@@ -97,9 +97,32 @@ static struct state const defaultstate = {
 	false,				// -F format was not given
 	FORMAT_RAW_BINARY,		// Read data as raw binary
 
+	// readModeFlag & readMode
+	false,				// -R readMode was not given
+	READ_STDIO,			// Read data through the shared stdio stream
+
+	// prefetchFlag, prefetchDepth & prefetchReaders
+	false,				// -Q depth[,readers] was not given
+	0,				// Do not read iterations ahead of the workers
+	0,				// No reader threads
+
+	// wisdomFlag, wisdomPath, wisdomRigor & wisdomFilename
+	false,				// -W wisdom[,rigor] was not given
+	NULL,				// Plan the DFT without FFTW wisdom
+	PLAN_ESTIMATE,			// Estimate the DFT plan
+	NULL,				// No wisdom file to import or export
+
+	// pinThreadsFlag
+	false,				// -N was not given, threads run wherever the scheduler puts them
+
+	// overlappingTemplate
+	NULL,				// Overlapping Template Test matches the template of m 1 bits
+
 	// numberOfThreads
 	false,
 	0,
+	1,				// Iterations do not split their blocks among threads
+	1,				// Each DFT is computed by a single fftw thread
 	0,
 
 	// jobnumFlag, jobnum & base_seek
@@ -136,8 +159,10 @@ static struct state const defaultstate = {
 	},
 	false,				// init() has not yet initialized c
 
-	// streamFile, finalReptPath, finalRept, freqFilePath, finalRept
+	// streamFile, mappedData, mappedLength, finalReptPath, finalRept, freqFilePath, finalRept
 	NULL,				// Initially the randomDataPath is not open
+	NULL,				// Initially the randomDataPath is not memory mapped
+	0,				// Nothing mapped yet
 	NULL,				// Path of the final results file
 	NULL,				// Initially the final results file is not open
 	NULL,				// Path of freq.txt
@@ -202,9 +227,15 @@ static struct state const defaultstate = {
 	 false, false, false, false, true, true, false, false,
 	},
 
-	// epsilon, tmpepsilon
+	// tmpepsilon, packedEpsilon, walk, walkVisitsNeeded, patterns, patternWidth, scratch, scratchSize
+	NULL,
 	NULL,
 	NULL,
+	false,
+	NULL,
+	0,
+	NULL,
+	0,
 
 	// count, valid, success, failure, valid_p_val
 	{0, 0, 0, 0, 0, 0, 0, 0,
@@ -223,6 +254,9 @@ static struct state const defaultstate = {
 	 0, 0, 0, 0, 0, 0, 0, 0,
 	},
 
+	// shard
+	NULL,
+
 	// metric_results & successful_tests
 	{FAILED_BOTH, FAILED_BOTH, FAILED_BOTH, FAILED_BOTH,
 	 FAILED_BOTH, FAILED_BOTH, FAILED_BOTH, FAILED_BOTH,
@@ -238,24 +272,15 @@ static struct state const defaultstate = {
 	// nonovTemplates
 	NULL,
 
-	// fft_m, fft_X
-	NULL,
-	NULL,
-
-# if defined(LEGACY_FFT)
-	// fft_wsave
-	NULL,
-#else /* LEGACY_FFT */
-	// fftw_p and fftw_out
-	NULL,
+#if !defined(LEGACY_FFT)
+	// fftw_p
 	NULL,
 #endif /* LEGACY_FFT */
 
 	// rank_matrix
 	NULL,
 
-	// rnd_excursion_var_stateX, ex_var_partial_sums
-	NULL,
+	// rnd_excursion_var_stateX
 	NULL,
 
 	// linear_b, linear_c, linear_t
@@ -263,24 +288,22 @@ static struct state const defaultstate = {
 	NULL,
 	NULL,
 
-	// apen_C, apen_C_len
-	NULL,
+	// apen_C_len
 	0,
 
-	// serial_v, serial_v_len
-	NULL,
+	// serial_v_len
 	0,
 
-	// nonper_seq
+	// nonovTemplateIndex, nonovNextMatch
+	NULL,
 	NULL,
 
-	// universal_L, universal_T
+	// universal_L, universal_log2, universal_log2_len
 	0,
+	NULL,
 	0,
 
-	// rnd_excursion_S, rnd_excursion_cycle, rnd_excursion_stateX, rnd_excursion_pi_terms
-	NULL,
-	NULL,
+	// rnd_excursion_stateX, rnd_excursion_pi_terms
 	NULL,
 	NULL,
 
@@ -296,9 +319,10 @@ static struct state const defaultstate = {
 /* *INDENT-OFF* */
 static const char * const usage =
 "[-v level] [-A] [-t test1[,test2]..]\n"
-"             [-P num=value[,num=value]..] [-i iterations] [-I reportCycle] [-O]\n"
-"             [-w workDir] [-c] [-s] [-F format] [-j jobnum] [-S bitcount]\n"
-"             [-m mode] [-T numOfThreads] [-d pvaluesdir] [-h] [randdata]\n"
+"             [-P num=value[,num=value]..] [-B template] [-i iterations] [-I reportCycle] [-O]\n"
+"             [-w workDir] [-c] [-s] [-F format] [-R readMode] [-j jobnum] [-S bitcount]\n"
+"             [-m mode] [-T numOfThreads] [-Q depth[,readers]] [-W wisdom[,rigor]] [-N]\n"
+"             [-d pvaluesdir] [-h] [randdata]\n"
 "\n"
 "    -v  debuglevel     debug level (def: 0 -> no debug messages)\n"
 "    -A                 ask a human what to do, use obsolete interactive mode (def: batch mode)\n"
@@ -328,7 +352,10 @@ static const char * const usage =
 "       9: Bits to process per iteration (same as -S bitcount):	1048576 (== 1024*1024)\n"
 "      10: Uniformity Cutoff Level:				0.0001\n"
 "      11: Alpha Confidence Level:				0.01\n"
-"      Warning: Change the above parameters only if you really know what you are doing!\n";
+"      Warning: Change the above parameters only if you really know what you are doing!\n"
+"\n"
+"    -B template        bits of the Overlapping Template Test template, e.g. 000000001, of length m (same as -P 3=m)\n"
+"                       (def: m 1 bits)\n";
 static const char * const usage2 =
 "\n"
 "    -i iterations      number of iterations (number of bitstreams) to test (if no -A, def: 1) (same as -P 7=iterations)\n"
@@ -340,6 +367,11 @@ static const char * const usage2 =
 "    -c                 don't create any directories needed for creating files (def: do create)\n"
 "    -s                 create result.txt, data*.txt, and stats.txt (def: don't create)\n"
 "    -F format          randdata format: 'r': raw binary, 'a': ASCII '0'/'1' chars (def: 'r')\n"
+"    -R readMode        how threads read randdata (def: 's')\n"
+"                       s --> seek and read a shared stdio stream, one thread at a time\n"
+"                       m --> memory map randdata, each thread copies its own iteration without locking\n"
+"                       p --> each thread opens randdata and pread()s its own iterations without locking\n"
+"                       Modes m and p require a randdata that is a regular file, not -\n"
 "    -S bitcount        Number of bits to process in a single iteration (def: 1048576 == 1024*1024) (same as -P 9=bitcount)\n"
 "    -j jobnum          seek into randdata, jobnum * bitcount * iterations bits (def: 0)\n"
 "                       Seeking is disabled if randdata is - and data for all jobs is read from beginning of standard input.\n"
@@ -350,6 +382,17 @@ static const char * const usage2 =
 "                       a --> collect the p-values from the binary files specified from '-d pvaluesdir' and assess them\n"
 "\n"
 "    -T numOfThreads    custom number of threads for this run (default: takes the number of cores of the CPU)\n"
+"    -Q depth[,readers] read up to depth iterations ahead of the test threads with readers reader threads\n"
+"                       (def: no read ahead, readers def: 1)\n"
+"    -W wisdom[,rigor]  import FFTW wisdom from the file wisdom before planning the DFT test, and export it when done\n"
+"                       A relative wisdom path is under workDir.  rigor is how a plan missing from the wisdom is made:\n"
+"                       e --> FFTW_ESTIMATE: estimate it, so only wisdom made by an earlier m or p run speeds the DFT\n"
+"                       m --> FFTW_MEASURE: measure it, slow the first time for a given bitcount (default rigor)\n"
+"                       p --> FFTW_PATIENT: measure more plans, slower still the first time\n"
+"                       Ignored by the legacy FFT.  (def: plan with FFTW_ESTIMATE, no wisdom file)\n"
+"    -N                 pin each test thread to its own CPU, taken node by node, and have it allocate its pattern counts\n"
+"                       and scratch arena itself so that they are placed on its NUMA node  (Linux only)\n"
+"                       (def: threads are not pinned)\n"
 "\n"
 "    -d pvaluesdir      path to the folder with the binary files with previously computed p-values (requires mode -m a)\n"
 "                       This will assess p-values found files of the form:\n"
@@ -388,6 +431,7 @@ parse_args(struct state *state, int argc, char **argv)
 	int scan_cnt;		// Number of items scanned by sscanf()
 	char *brkt;		// Last state of strtok_r()
 	char *phrase;		// String without separator as parsed by strtok_r()
+	char *rigor;		// -W wisdom,rigor: comma before the rigor, or NULL
 	long int testnum;	// Parsed test number
 	long int num;		// Parsed parameter number
 	long int value;		// Parsed parameter integer value
@@ -423,7 +467,7 @@ parse_args(struct state *state, int argc, char **argv)
 	 */
 	opterr = 0;
 	brkt = NULL;
-	while ((option = getopt(argc, argv, "v:Abt:g:pP:S:i:I:Ow:csf:F:j:m:T:d:h")) != -1) {
+	while ((option = getopt(argc, argv, "v:Abt:g:pP:B:S:i:I:Ow:csf:F:R:j:m:T:Q:W:Nd:h")) != -1) {
 		switch (option) {
 
 		case 'v':	// -v debuglevel
@@ -551,6 +595,20 @@ parse_args(struct state *state, int argc, char **argv)
 			}
 			break;
 
+		case 'B':	// -B template
+			if (strlen(optarg) < 1 || strlen(optarg) > BITS_N_WORD64 || strspn(optarg, "01") != strlen(optarg)) {
+				usage_err(1, __func__, "-B template must be 1 to %d bits, each 0 or 1: %s", BITS_N_WORD64, optarg);
+			}
+			if (state->overlappingTemplate != NULL) {
+				free(state->overlappingTemplate);
+			}
+			state->overlappingTemplate = malloc(strlen(optarg) + 1);
+			if (state->overlappingTemplate == NULL) {
+				errp(1, __func__, "cannot malloc of %lu bytes for -B template", strlen(optarg) + 1);
+			}
+			strcpy(state->overlappingTemplate, optarg);
+			break;
+
 		case 'p':	// -p is now obsolete because batch is the default
 			usage_err(1, __func__, "-p is no longer needed");
 			break;
@@ -628,6 +686,27 @@ parse_args(struct state *state, int argc, char **argv)
 			}
 			break;
 
+		case 'R':	// -R readMode: 's': shared stdio stream, 'm': memory mapped randdata, 'p': positional reads
+			state->readModeFlag = true;
+			if (optarg[0] == '\0' || optarg[1] != '\0') {
+				usage_err(1, __func__, "-R readMode must be a single character: %s", optarg);
+			}
+			switch (optarg[0]) {
+			case READ_STDIO:
+				state->readMode = READ_STDIO;
+				break;
+			case READ_MMAP:
+				state->readMode = READ_MMAP;
+				break;
+			case READ_PREAD:
+				state->readMode = READ_PREAD;
+				break;
+			default:
+				usage_err(1, __func__, "-R readMode must be one of s, m or p: %c", optarg[0]);
+				break;
+			}
+			break;
+
 		case 'f':
 			usage_err(1, __func__, "-f is no longer needed, instead put randdata as last argument");
 			break;
@@ -675,6 +754,67 @@ parse_args(struct state *state, int argc, char **argv)
 			}
 			break;
 
+		case 'Q':	// -Q depth[,readers]
+			state->prefetchFlag = true;
+			state->prefetchReaders = 1;
+			scan_cnt = sscanf(optarg, "%ld,%ld", &state->prefetchDepth, &state->prefetchReaders);
+			if (scan_cnt == EOF) {
+				usage_errp(1, __func__, "error in parsing -Q depth[,readers]: %s", optarg);
+			} else if (scan_cnt < 1) {
+				usage_err(1, __func__, "-Q depth[,readers] must be one or two comma separated integers: %s",
+					  optarg);
+			}
+			if (state->prefetchDepth < 1) {
+				usage_err(1, __func__, "-Q depth: %ld must be >= 1", state->prefetchDepth);
+			}
+			if (state->prefetchReaders < 1 || state->prefetchReaders > state->prefetchDepth) {
+				usage_err(1, __func__, "-Q depth,readers: readers: %ld must be in the range [1-%ld]",
+					  state->prefetchReaders, state->prefetchDepth);
+			}
+			break;
+
+		case 'W':	// -W wisdom[,rigor]
+			state->wisdomFlag = true;
+			state->wisdomPath = malloc(strlen(optarg) + 1);
+			if (state->wisdomPath == NULL) {
+				errp(1, __func__, "cannot malloc of %lu bytes for -W wisdom", strlen(optarg) + 1);
+			}
+			strcpy(state->wisdomPath, optarg);
+			state->wisdomRigor = PLAN_MEASURE;
+			rigor = strrchr(state->wisdomPath, ',');
+			if (rigor != NULL) {
+				if (rigor[1] == '\0' || rigor[2] != '\0') {
+					usage_err(1, __func__, "-W wisdom,rigor: rigor must be a single character: %s", rigor + 1);
+				}
+				switch (rigor[1]) {
+				case PLAN_ESTIMATE:
+					state->wisdomRigor = PLAN_ESTIMATE;
+					break;
+				case PLAN_MEASURE:
+					state->wisdomRigor = PLAN_MEASURE;
+					break;
+				case PLAN_PATIENT:
+					state->wisdomRigor = PLAN_PATIENT;
+					break;
+				default:
+					usage_err(1, __func__, "-W wisdom,rigor: rigor must be one of e, m or p: %c", rigor[1]);
+					break;
+				}
+				*rigor = '\0';
+			}
+			if (state->wisdomPath[0] == '\0') {
+				usage_err(1, __func__, "-W wisdom[,rigor]: wisdom must not be empty: %s", optarg);
+			}
+			break;
+
+		case 'N':	// -N (pin test threads to CPUs)
+#if defined(__linux__)
+			state->pinThreadsFlag = true;
+#else /* __linux__ */
+			usage_err(1, __func__, "-N is only supported on Linux, where threads can be pinned to CPUs");
+#endif /* __linux__ */
+			break;
+
 		case 'd':	// -d folder with precomputed .pvalues files
 			state->pvalues_dir = strdup(optarg);
 			if (state->pvalues_dir == NULL) {
@@ -742,6 +882,27 @@ parse_args(struct state *state, int argc, char **argv)
 		}
 	}
 
+	/*
+	 * The -B template sets the Overlapping Template Test template length, unless -P 3=m set another one
+	 */
+	if (state->overlappingTemplate != NULL) {
+		if (state->tp.overlappingTemplateLength != DEFAULT_OVERLAPPING &&
+		    state->tp.overlappingTemplateLength != (long int) strlen(state->overlappingTemplate)) {
+			usage_err(1, __func__, "-B template %s has %lu bits, but -P 3=m set m to %ld",
+				  state->overlappingTemplate, strlen(state->overlappingTemplate),
+				  state->tp.overlappingTemplateLength);
+		}
+		state->tp.overlappingTemplateLength = (long int) strlen(state->overlappingTemplate);
+	}
+
+	/*
+	 * A memory mapped or positionally read randdata must be a file, not standard input
+	 */
+	if ((state->readMode == READ_MMAP || state->readMode == READ_PREAD) && state->stdinData == true) {
+		usage_err(1, __func__, "-R %c not allowed when randdata is - (reading data from standard input)",
+			  (char) state->readMode);
+	}
+
 	/*
 	 * Ask how many iterations have to be performed unless batch mode (-b) is enabled or -i bitstreams was not given
 	 */
@@ -803,11 +964,11 @@ parse_args(struct state *state, int argc, char **argv)
 	}
 
 	/*
-	 * If no custom number of threads was set, set the number of threads to be equal to the minimum
-	 * between the number of bitstreams and the number of cores of the computer where sts is running.
+	 * If no custom number of threads was set, set the number of threads to be equal to the number
+	 * of cores of the computer where sts is running.
 	 */
 	else if (state->numberOfThreadsFlag == false) {
-		state->numberOfThreads = MIN(sysconf(_SC_NPROCESSORS_ONLN), state->tp.numOfBitStreams);
+		state->numberOfThreads = sysconf(_SC_NPROCESSORS_ONLN);
 	}
 
 	/*
@@ -821,14 +982,28 @@ parse_args(struct state *state, int argc, char **argv)
 	}
 
 	/*
-	 * If a custom number of threads was set and this number is greater than the number of bitstreams
-	 * (aka iterations) set, fire a warning to the user that only $numOfBitstreams threads will be used.
+	 * Every test thread takes (iteration, test) tasks from the shared task graph, so a test thread that
+	 * has no iteration of its own steals the tests of the others, even when there are more threads than
+	 * bitstreams (aka iterations).  All the threads given with -T are thus test threads.
+	 *
+	 * When there are fewer bitstreams than test threads, the tests with independent blocks split each
+	 * bitstream into shares, which the idle test threads take from the task graph (see runBlocks()).
+	 * As the shares are worked on by the test threads themselves, this never adds threads to the run.
+	 */
+	if (state->numberOfThreads > state->tp.numOfBitStreams && state->tp.numOfBitStreams > 0) {
+		state->blockThreads = (state->numberOfThreads + state->tp.numOfBitStreams - 1) / state->tp.numOfBitStreams;
+	}
+
+	/*
+	 * The fftw library starts threads of its own.  When no custom number of threads was set and there are
+	 * fewer (iteration, test) tasks than cores, each DFT is given the cores that its task leaves over.  At
+	 * most one DFT per iteration runs at once, so the fftw threads add at most cores / test_cnt threads to
+	 * the run, which only compete for the cores while the idle test threads work on shares.  With -T
+	 * numOfThreads the user chose how many threads to run, so each DFT is computed by a single thread.
 	 */
-	if (state->numberOfThreadsFlag == true && state->numberOfThreads > state->tp.numOfBitStreams) {
-		warn(__func__, "You chose to use %ld threads. However this number is greater than the number of bitstreams, which"
-				     " you set to %ld. Therefore only %ld threads will be used.", state->numberOfThreads,
-		     state->tp.numOfBitStreams, state->tp.numOfBitStreams);
-		state->numberOfThreads = state->tp.numOfBitStreams;
+	if (state->numberOfThreadsFlag == false && test_cnt > 0 &&
+	    state->numberOfThreads > state->tp.numOfBitStreams * test_cnt) {
+		state->fftwThreads = state->numberOfThreads / (state->tp.numOfBitStreams * test_cnt);
 	}
 
 	/*
@@ -1179,6 +1354,25 @@ print_option_summary(struct state *state, char *where)
 		dbg(DBG_MED, "\t  unknown format: %c", (char) state->dataFormat);
 		break;
 	}
+	if (state->readModeFlag == true) {
+		dbg(DBG_MED, "\t-R readMode was given");
+	} else {
+		dbg(DBG_MED, "\tno -R readMode was given");
+	}
+	switch (state->readMode) {
+	case READ_STDIO:
+		dbg(DBG_MED, "\t  read through a shared stdio stream, one thread at a time");
+		break;
+	case READ_MMAP:
+		dbg(DBG_MED, "\t  memory map randdata, threads copy their iterations without locking");
+		break;
+	case READ_PREAD:
+		dbg(DBG_MED, "\t  each thread pread()s its iterations from its own file descriptor");
+		break;
+	default:
+		dbg(DBG_MED, "\t  unknown readMode: %c", (char) state->readMode);
+		break;
+	}
 	dbg(DBG_MED, "\tjobnum: -j %ld", state->jobnum);
 	if (state->jobnumFlag == true) {
 		dbg(DBG_MED, "\t-j jobnum was set to %ld", state->jobnum);
@@ -1200,7 +1394,44 @@ print_option_summary(struct state *state, char *where)
 	} else {
 		dbg(DBG_MED, "\tno -T numOfThreads was given");
 	}
-	dbg(DBG_MED, "\t  will use %ld threads\n", state->numberOfThreads);
+	dbg(DBG_MED, "\t  will use %ld threads", state->numberOfThreads);
+	if (state->blockThreads > 1) {
+		dbg(DBG_MED, "\t  tests with independent blocks will split each iteration into %ld shares",
+		    state->blockThreads);
+	}
+	if (state->fftwThreads > 1) {
+		dbg(DBG_MED, "\t  each DFT will be computed by %ld fftw threads", state->fftwThreads);
+	}
+	if (state->prefetchFlag == true) {
+		dbg(DBG_MED, "\t-Q depth[,readers] was given");
+		dbg(DBG_MED, "\t  %ld reader threads will read up to %ld iterations ahead\n", state->prefetchReaders,
+		    state->prefetchDepth);
+	} else {
+		dbg(DBG_MED, "\tno -Q depth[,readers] was given");
+		dbg(DBG_MED, "\t  test threads read their own iterations\n");
+	}
+	if (state->wisdomFlag == true) {
+		dbg(DBG_MED, "\t-W wisdom was given");
+		dbg(DBG_MED, "\t  DFT plans will use the FFTW wisdom in: %s", state->wisdomPath);
+		dbg(DBG_MED, "\t  DFT plans missing from the wisdom will be planned with rigor: %c", state->wisdomRigor);
+	} else {
+		dbg(DBG_MED, "\tno -W wisdom was given");
+		dbg(DBG_MED, "\t  DFT plans will be estimated without FFTW wisdom");
+	}
+	if (state->overlappingTemplate != NULL) {
+		dbg(DBG_MED, "\t-B template was given");
+		dbg(DBG_MED, "\t  Overlapping Template Test will match the template: %s", state->overlappingTemplate);
+	} else {
+		dbg(DBG_MED, "\tno -B template was given");
+		dbg(DBG_MED, "\t  Overlapping Template Test will match the template of m 1 bits");
+	}
+	if (state->pinThreadsFlag == true) {
+		dbg(DBG_MED, "\t-N was given");
+		dbg(DBG_MED, "\t  test threads will be pinned to CPUs of a NUMA node and place their working buffers on it");
+	} else {
+		dbg(DBG_MED, "\tno -N was given");
+		dbg(DBG_MED, "\t  test threads will not be pinned to CPUs");
+	}
 
 	/*
 	 * Report on test parameters
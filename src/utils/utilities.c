@@ -26,7 +26,7 @@
  */
 
 
-// Exit codes: 210 thru 234
+// Exit codes: 210 thru 246
 
 // global capabilities
 #define _ATFILE_SOURCE
@@ -41,10 +41,26 @@
 #include <pthread.h>
 #include <unistd.h>
 
+// for pinning threads to CPUs of a NUMA node (-N)
+#if defined(__linux__)
+#include <sched.h>
+#include <dirent.h>
+#endif /* __linux__ */
+
 // for checking dir
 #include <fcntl.h>
 #include <sys/stat.h>
 
+// for memory mapping randdata
+#include <sys/mman.h>
+
+// for decoding ASCII '0'/'1' data many characters at a time
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // for stpncpy() and getline()
 #include <string.h>
 #include <stdio.h>
@@ -55,6 +71,12 @@
 #include "debug.h"
 
 
+/*
+ * Most ASCII '0'/'1' characters read by a single pread() under -R p
+ */
+#define ASCII_READ_CHUNK (64 * 1024)
+
+
 /*
  * Forward static function declarations
  */
@@ -63,8 +85,42 @@ static char * getString(FILE * stream);
 static bool checkReadPermissions(char *path);
 static void handleFileBasedBitStreams(struct state *state);
 static void *testBits(void *thread_args);
+static void *prefetchBits(void *thread_args);
+static struct task_graph *createTaskGraph(struct state *state);
+static void destroyTaskGraph(struct task_graph *graph);
+static bool nextTask(struct thread_state *thread_state, struct test_task *task);
+static bool loadIteration(struct thread_state *thread_state, struct loaded_iteration *loaded);
+static void runTask(struct thread_state *thread_state, struct test_task *task);
+static bool readNextIteration(struct thread_state *thread_state);
+static bool takePrefetchedIteration(struct thread_state *thread_state);
+static struct prefetch_ring *createPrefetchRing(struct state *state);
+static void destroyPrefetchRing(struct prefetch_ring *ring);
 static void parseBitsASCIIInput(struct thread_state *thread_state);
 static void parseBitsBinaryInput(struct thread_state *thread_state);
+static void parseBitsMappedInput(struct thread_state *thread_state);
+static void parseASCIIPositionalInput(struct thread_state *thread_state);
+static long int decodeASCIIBits(BYTE const *src, long int srcLen, WORD64 *dst, long int first, long int bitsNeeded,
+				long int *used, long int *num_1s);
+static long int packBytes(WORD64 *dst, BYTE const *src, long int bitCount);
+static void parseBitsPositionalInput(struct thread_state *thread_state);
+static void reportBitsRead(struct thread_state *thread_state, long int bitsRead, long int num_0s, long int num_1s);
+static void openPositionalInput(struct thread_state *thread_state);
+static void closePositionalInput(struct thread_state *thread_state);
+static void makeWalkSteps(void);
+static void runShare(struct thread_state *thread_state, struct task_graph *graph);
+static void createBlockShares(struct thread_state *thread_state);
+static void destroyBlockShares(struct thread_state *thread_state);
+#if defined(__linux__)
+static int orderCPUsByNode(cpu_set_t const *allowed, int *order, int *nodeOf);
+static void pinThread(struct state *state, pthread_attr_t *attr, long int thread_id);
+static void placeThreadBuffers(struct thread_state *thread_state);
+#endif /* __linux__ */
+static void mapInputFile(struct state *state);
+static void createResultShards(struct state *state);
+static void mergeResultShards(struct state *state);
+static void mergeInIterationOrder(struct state *state, int test, struct dyn_array *merged, struct dyn_array **parts,
+				  long int const *slot, long int iterationCount);
+static void unmapInputFile(struct state *state);
 
 
 /*
@@ -1481,10 +1537,13 @@ handleFileBasedBitStreams(struct state *state)
 {
 	int io_ret;		// I/O return status
 	long int i;
-	pthread_t thread[state->numberOfThreads];
+	long int threadCount;	// Number of test threads plus prefetch reader threads
 	pthread_attr_t attr;
 	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-	struct thread_state *thread_args = malloc(state->numberOfThreads * sizeof(struct thread_state));
+	struct prefetch_ring *ring = NULL;	// Iterations read ahead of the test threads, or NULL
+	struct task_graph *graph;	// (iteration, test) tasks shared among the test threads
+	pthread_t *thread;
+	struct thread_state *thread_args;
 	void *status;
 
 	/*
@@ -1494,6 +1553,20 @@ handleFileBasedBitStreams(struct state *state)
 		err(224, __func__, "state arg is NULL");
 	}
 
+	/*
+	 * Allocate the per thread state of the test threads followed by that of the prefetch reader threads
+	 */
+	threadCount = state->numberOfThreads + (state->prefetchDepth > 0 ? state->prefetchReaders : 0);
+	thread = malloc((size_t) threadCount * sizeof(*thread));
+	if (thread == NULL) {
+		errp(224, __func__, "cannot malloc for thread: %ld elements of %lu bytes each", threadCount, sizeof(*thread));
+	}
+	thread_args = malloc((size_t) threadCount * sizeof(*thread_args));
+	if (thread_args == NULL) {
+		errp(224, __func__, "cannot malloc for thread_args: %ld elements of %lu bytes each", threadCount,
+		     sizeof(*thread_args));
+	}
+
 	/*
 	 * when reading randdata from stdin, we do not seek no matter what our jobnum is
 	 */
@@ -1526,6 +1599,23 @@ handleFileBasedBitStreams(struct state *state)
 		state->base_seek = ((state->jobnum * state->tp.n * state->tp.numOfBitStreams) + BITS_N_BYTE - 1) / BITS_N_BYTE;
 	}
 
+	/*
+	 * Map the input file if threads are to copy their iterations directly from memory
+	 */
+	if (state->readMode == READ_MMAP) {
+		mapInputFile(state);
+	}
+
+	/*
+	 * Give each test thread its own shard in which to record its results
+	 */
+	createResultShards(state);
+
+	/*
+	 * Setup the (iteration, test) tasks to be shared among the test threads
+	 */
+	graph = createTaskGraph(state);
+
 	/*
 	 * Initialize and set thread detached attribute
 	 */
@@ -1535,14 +1625,39 @@ handleFileBasedBitStreams(struct state *state)
 	dbg(DBG_LOW, "Start of iterate phase");
 
 	/*
-	 * Run numberOfThreads threads
+	 * Setup the ring of iterations to be read ahead of the test threads, if requested
 	 */
-	for (i = 0; i < state->numberOfThreads; i++) {
+	if (state->prefetchDepth > 0) {
+		ring = createPrefetchRing(state);
+		dbg(DBG_LOW, "%ld reader threads will read up to %ld iterations ahead of %ld test threads",
+		    state->prefetchReaders, ring->depth, state->numberOfThreads);
+	}
+
+	/*
+	 * Run numberOfThreads test threads, each with room for the block shares of its iterations when
+	 * state->blockThreads > 1, followed by the prefetch reader threads (if any)
+	 */
+	for (i = 0; i < threadCount; i++) {
 		thread_args[i].global_state = state;
 		thread_args[i].thread_id = i;
 		thread_args[i].mutex = &mutex;
+		thread_args[i].inputFd = -1;
+		thread_args[i].inputBuf = NULL;
+		thread_args[i].ring = ring;
+		thread_args[i].blocks = NULL;
+		thread_args[i].graph = (i < state->numberOfThreads ? graph : NULL);
+		thread_args[i].cachedIteration = -1;
+#if defined(__linux__)
+		if (state->pinThreadsFlag == true) {
+			pinThread(state, &attr, i);
+		}
+#endif /* __linux__ */
+		if (i < state->numberOfThreads && state->blockThreads > 1) {
+			createBlockShares(&thread_args[i]);
+		}
 
-		io_ret = pthread_create(&thread[i], &attr, testBits, &thread_args[i]);
+		io_ret = pthread_create(&thread[i], &attr, (i < state->numberOfThreads ? testBits : prefetchBits),
+					&thread_args[i]);
 		if (io_ret != 0) {
 			errp(224, __func__, "error on pthread_create()");
 		}
@@ -1554,16 +1669,49 @@ handleFileBasedBitStreams(struct state *state)
 	 * Free attribute and wait for the threads to finish
 	 */
 	pthread_attr_destroy(&attr);
-	for (i = 0; i < state->numberOfThreads; i++) {
+	for (i = 0; i < threadCount; i++) {
 		io_ret = pthread_join(thread[i], &status);
 		if (io_ret != 0) {
 			errp(224, __func__, "error on pthread_join()");
 		}
+		if (thread_args[i].blocks != NULL) {
+			destroyBlockShares(&thread_args[i]);
+		}
 	}
 	pthread_mutex_destroy(&mutex);
+	free(thread);
+	free(thread_args);
+
+	/*
+	 * Collect the results of all of the test threads
+	 */
+	mergeResultShards(state);
+	dbg(DBG_LOW, "%ld test threads stole %ld tasks from each other and waited for a task %ld times",
+	    graph->threads, graph->steals, graph->waits);
+	dbg(DBG_LOW, "%ld test threads worked on %ld block shares of iterations run by another thread",
+	    graph->threads, graph->shareSteals);
+	destroyTaskGraph(graph);
+	graph = NULL;
 
 	dbg(DBG_LOW, "End of iterate phase\n");
 
+	/*
+	 * Report how well the prefetch ring kept up and free its spare buffers
+	 */
+	if (ring != NULL) {
+		dbg(DBG_LOW, "prefetch ring of depth %ld: test threads waited for data %ld times, "
+		    "readers waited for a free buffer %ld times", ring->depth, ring->workerWaits, ring->readerWaits);
+		destroyPrefetchRing(ring);
+		ring = NULL;
+	}
+
+	/*
+	 * Unmap the input file if it was mapped
+	 */
+	if (state->mappedData != NULL) {
+		unmapInputFile(state);
+	}
+
 	/*
 	 * Close the input file
 	 */
@@ -1578,309 +1726,3027 @@ handleFileBasedBitStreams(struct state *state)
 }
 
 
+/*
+ * createResultShards - allocate the result shard of each test thread
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * Each shard gets an empty stats and p_val dynamic array for every test that has them in state,
+ * with the same element size, so that a test thread can record its results exactly as if
+ * it were recording them in state.
+ *
+ * This function does not return on error.
+ */
 static void
-*testBits(void *thread_args)
+createResultShards(struct state *state)
 {
-	struct thread_state *thread_state = (struct thread_state *) thread_args;
-	char buf[BUFSIZ + 1];	// time string buffer
+	struct result_shard *shard;	// Result shard of a test thread
+	long int start;			// Number of elements to initially allocate in a shard array
+	long int i;
+	int j;
 
 	/*
 	 * Check preconditions (firewall)
 	 */
-	if (thread_state == NULL) {
-		err(225, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
 	if (state == NULL) {
-		err(225, __func__, "state arg is NULL");
+		err(239, __func__, "state arg is NULL");
+	}
+	if (state->numberOfThreads <= 0) {
+		err(239, __func__, "state->numberOfThreads: %ld must be > 0", state->numberOfThreads);
 	}
 
-	dbg(DBG_HIGH, "Thread %ld started.", thread_state->thread_id);
-
-	while (1) {
-		pthread_mutex_lock(thread_state->mutex);
-
-		if (state->iterationsMissing == 0) {
-			pthread_mutex_unlock(thread_state->mutex);
-			break;
+	state->shard = calloc((size_t) state->numberOfThreads, sizeof(*state->shard));
+	if (state->shard == NULL) {
+		errp(239, __func__, "cannot calloc for shard: %ld elements of %lu bytes each",
+		     state->numberOfThreads, sizeof(*state->shard));
+	}
+	for (i = 0; i < state->numberOfThreads; i++) {
+		shard = &state->shard[i];
+		for (j = 0; j <= NUMOFTESTS; j++) {
+			start = state->tp.numOfBitStreams / state->numberOfThreads + 1;
+			shard->iterations[j] = create_dyn_array(sizeof(long int), DEFAULT_CHUNK, start, false);
+			if (state->stats[j] != NULL) {
+				start = state->stats[j]->allocated / state->numberOfThreads + 1;
+				shard->stats[j] = create_dyn_array(state->stats[j]->elm_size, DEFAULT_CHUNK, start, false);
+			}
+			if (state->p_val[j] != NULL) {
+				start = state->p_val[j]->allocated / state->numberOfThreads + 1;
+				shard->p_val[j] = create_dyn_array(state->p_val[j]->elm_size, DEFAULT_CHUNK, start, false);
+			}
 		}
+	}
+	return;
+}
 
-		thread_state->iteration_being_done = state->tp.numOfBitStreams - state->iterationsMissing;
-		state->iterationsMissing -= 1;
 
-		/*
-		 * Parse and data for this iteration
-		 */
-		if (state->dataFormat == FORMAT_ASCII_01) {
-			parseBitsASCIIInput(thread_state);
-		} else {
-			parseBitsBinaryInput(thread_state);
-		}
+/*
+ * mergeResultShards - merge the result shards of the test threads into state, and free them
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * The counters of the shards are added to those of state.  The values in the stats and p_val arrays
+ * of the shards are appended to those of state in iteration order, so that they come out the same
+ * no matter how many threads did the iterations of each test, or in which order the threads finished them.
+ *
+ * NOTE: This function must only be called after all test threads have been joined.
+ *
+ * This function does not return on error.
+ */
+static void
+mergeResultShards(struct state *state)
+{
+	struct result_shard *shard;	// Result shard of a test thread
+	struct dyn_array **parts;	// Per thread stats or p_val arrays of a test
+	long int *slot;			// slot[iteration]: position of the iteration among all of the iterations done
+	long int iterationCount;	// Number of iterations of a test done by all of the test threads
+	long int iteration;		// An iteration done by a test thread
+	long int i;
+	long int r;
+	int j;
 
-		pthread_mutex_unlock(thread_state->mutex);
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(240, __func__, "state arg is NULL");
+	}
+	if (state->shard == NULL) {
+		err(240, __func__, "state->shard is NULL");
+	}
+
+	slot = malloc((size_t) state->tp.numOfBitStreams * sizeof(slot[0]));
+	if (slot == NULL) {
+		errp(240, __func__, "cannot malloc for slot: %ld elements of %lu bytes each",
+		     state->tp.numOfBitStreams, sizeof(slot[0]));
+	}
+	parts = malloc((size_t) state->numberOfThreads * sizeof(parts[0]));
+	if (parts == NULL) {
+		errp(240, __func__, "cannot malloc for parts: %ld elements of %lu bytes each",
+		     state->numberOfThreads, sizeof(parts[0]));
+	}
+	for (j = 0; j <= NUMOFTESTS; j++) {
 
 		/*
-		 * Perform one iteration on the bitstreams read from the streamFile
+		 * Number the iterations of the test done in increasing order
+		 *
+		 * When every iteration is done, as is normally the case, slot[iteration] == iteration.
 		 */
-		iterate(thread_state);
+		for (iteration = 0; iteration < state->tp.numOfBitStreams; iteration++) {
+			slot[iteration] = -1;
+		}
+		for (i = 0; i < state->numberOfThreads; i++) {
+			shard = &state->shard[i];
+			for (r = 0; r < shard->iterations[j]->count; r++) {
+				iteration = get_value(shard->iterations[j], long int, r);
+				if (iteration < 0 || iteration >= state->tp.numOfBitStreams || slot[iteration] >= 0) {
+					err(240, __func__, "thread %ld did an unexpected iteration: %ld of test: %d", i, iteration, j);
+				}
+				slot[iteration] = 0;
+			}
+		}
+		iterationCount = 0;
+		for (iteration = 0; iteration < state->tp.numOfBitStreams; iteration++) {
+			if (slot[iteration] >= 0) {
+				slot[iteration] = iterationCount++;
+			}
+		}
 
 		/*
-		 * Report iteration done (if requested)
+		 * Add up the counters and merge the arrays of the test
 		 */
-		if (state->reportCycle > 0 && (((thread_state->iteration_being_done % state->reportCycle) == 0) ||
-					       (thread_state->iteration_being_done == state->tp.numOfBitStreams))) {
-			getTimestamp(buf, BUFSIZ);
-			msg("Completed iteration %ld of %ld at %s", thread_state->iteration_being_done + 1,
-			    state->tp.numOfBitStreams, buf);
+		for (i = 0; i < state->numberOfThreads; i++) {
+			shard = &state->shard[i];
+			state->count[j] += shard->count[j];
+			state->valid[j] += shard->valid[j];
+			state->success[j] += shard->success[j];
+			state->failure[j] += shard->failure[j];
+			state->valid_p_val[j] += shard->valid_p_val[j];
+		}
+		if (state->stats[j] != NULL) {
+			for (i = 0; i < state->numberOfThreads; i++) {
+				parts[i] = state->shard[i].stats[j];
+			}
+			mergeInIterationOrder(state, j, state->stats[j], parts, slot, iterationCount);
+		}
+		if (state->p_val[j] != NULL) {
+			for (i = 0; i < state->numberOfThreads; i++) {
+				parts[i] = state->shard[i].p_val[j];
+			}
+			mergeInIterationOrder(state, j, state->p_val[j], parts, slot, iterationCount);
 		}
 	}
 
-	pthread_exit((void *) thread_state->thread_id);
+	/*
+	 * Free the shards
+	 */
+	for (i = 0; i < state->numberOfThreads; i++) {
+		shard = &state->shard[i];
+		for (j = 0; j <= NUMOFTESTS; j++) {
+			if (shard->stats[j] != NULL) {
+				free_dyn_array(shard->stats[j]);
+				free(shard->stats[j]);
+				shard->stats[j] = NULL;
+			}
+			if (shard->p_val[j] != NULL) {
+				free_dyn_array(shard->p_val[j]);
+				free(shard->p_val[j]);
+				shard->p_val[j] = NULL;
+			}
+			free_dyn_array(shard->iterations[j]);
+			free(shard->iterations[j]);
+			shard->iterations[j] = NULL;
+		}
+	}
+	free(parts);
+	free(slot);
+	free(state->shard);
+	state->shard = NULL;
+	return;
 }
 
 
 /*
- * parseBitsASCIIInput - read bits from the streamFile and save them into epsilon bit array
+ * mergeInIterationOrder - append the values that the test threads recorded for one test in iteration order
  *
  * given:
  *      state           // pointer to run state
+ *      test            // the test whose values are merged
+ *      merged          // stats or p_val array of the test in state to append to
+ *      parts           // parts[i]: matching array of the result shard of test thread i
+ *      slot            // slot[iteration]: position of the iteration among all of the iterations of the test done
+ *      iterationCount  // number of iterations of the test done by all of the test threads
  *
- * Given the open steam streamFile, from file state->randomDataPath, convert its ASCII characters
- * into 'bits' for the epsilon bit array.
+ * Every iteration of a test records the same number of values, so the values of the r-th iteration
+ * of the test done by a thread are those at r * perIteration in its part, and go to slot[iteration] * perIteration.
+ *
+ * This function does not return on error.
  */
 static void
-parseBitsASCIIInput(struct thread_state *thread_state)
+mergeInIterationOrder(struct state *state, int test, struct dyn_array *merged, struct dyn_array **parts,
+		      long int const *slot, long int iterationCount)
 {
+	struct dyn_array *iterations;	// Iterations of the test done by a test thread
+	unsigned char *ordered;		// Values of all iterations, in iteration order
+	long int perIteration;		// Number of values recorded by each iteration
+	long int total;			// Number of values recorded by all of the test threads
+	size_t size;			// Size of the values of one iteration
+	long int iteration;		// An iteration done by a test thread
 	long int i;
-	long int num_0s;
-	long int num_1s;
-	long int bitsRead;
-	int bit;
-	int io_ret;		// I/O return status
+	long int r;
 
 	/*
-	 * Check preconditions (firewall)
+	 * Find how many values each iteration recorded
 	 */
-	if (thread_state == NULL) {
-		err(225, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
-	if (state == NULL) {
-		err(225, __func__, "state arg is NULL");
+	total = 0;
+	for (i = 0; i < state->numberOfThreads; i++) {
+		total += parts[i]->count;
 	}
-	if (state->streamFile == NULL) {
-		err(225, __func__, "streamFile arg is NULL");
+	if (total == 0) {
+		return;
 	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(227, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	perIteration = (iterationCount > 0) ? total / iterationCount : 0;
+	for (i = 0; i < state->numberOfThreads; i++) {
+		iterations = state->shard[i].iterations[test];
+		if (parts[i]->count != perIteration * iterations->count) {
+			err(241, __func__, "thread %ld recorded %ld values for %ld iterations of test: %d, expected %ld per iteration",
+			    i, parts[i]->count, iterations->count, test, perIteration);
+		}
 	}
 
 	/*
-	 * If not reading randdata from stdin,
-	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 * Put the values of each iteration in its slot
 	 */
-	if (state->stdinData == false &&
-	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n, SEEK_SET) != 0) {
-		errp(226, __func__, "could not seek %ld further into file: %s",
-		     (thread_state->iteration_being_done * state->tp.n), state->randomDataPath);
+	size = (size_t) perIteration * merged->elm_size;
+	ordered = malloc((size_t) total * merged->elm_size);
+	if (ordered == NULL) {
+		errp(241, __func__, "cannot malloc for ordered: %ld elements of %lu bytes each", total, merged->elm_size);
+	}
+	for (i = 0; i < state->numberOfThreads; i++) {
+		iterations = state->shard[i].iterations[test];
+		for (r = 0; r < iterations->count; r++) {
+			iteration = get_value(iterations, long int, r);
+			memcpy(ordered + slot[iteration] * size, (unsigned char *) parts[i]->data + r * size, size);
+		}
 	}
+	append_array(merged, ordered, total);
+	free(ordered);
+	return;
+}
+
+
+#if defined(__linux__)
+/*
+ * orderCPUsByNode - list the CPUs on which we are allowed to run, grouped by NUMA node
+ *
+ * given:
+ *      allowed         // CPUs on which this process may run
+ *      order           // array of CPU_SETSIZE ints, set to the allowed CPUs in the order they are to be used
+ *      nodeOf          // array of CPU_SETSIZE ints, nodeOf[cpu] is set to the NUMA node of cpu, or -1 if unknown
+ *
+ * returns:
+ *      number of allowed CPUs listed in order[]
+ *
+ * The NUMA nodes and their CPUs are read from /sys/devices/system/node.  The allowed CPUs are listed
+ * node by node, so that consecutive test threads run on the same node, followed by any allowed CPU of
+ * unknown node.  Without /sys/devices/system/node, as on a kernel built without NUMA, the allowed CPUs
+ * are simply listed in increasing order.
+ */
+static int
+orderCPUsByNode(cpu_set_t const *allowed, int *order, int *nodeOf)
+{
+	DIR *dir;		// /sys/devices/system/node
+	struct dirent *entry;	// An entry of dir
+	FILE *cpulist;		// cpulist of a node: comma separated CPUs and ranges of CPUs
+	char path[PATH_MAX + 1];	// Path of the cpulist of a node
+	int maxNode;		// Highest NUMA node found
+	int node;		// A NUMA node
+	int count;		// Number of CPUs listed in order
+	int first;		// First CPU of a range in cpulist
+	int last;		// Last CPU of a range in cpulist
+	int i;
 
 	/*
-	 * Copy the next n bits from the streamFile to epsilon
+	 * Find the highest NUMA node
 	 */
-	num_0s = 0;
-	num_1s = 0;
-	bitsRead = 0;
-	clearerr(state->streamFile);
-	for (i = 0; i < state->tp.n; i++) {
-		io_ret = fscanf(state->streamFile, "%1d", &bit);
-		if (io_ret == EOF) {
-			warn(__func__, "Insufficient data in file %s: %ld bits were read", state->randomDataPath,
-			     bitsRead);
-			return;
-		} else {
-			bitsRead++;
-			if (bit == 0) {
-				num_0s++;
-			} else {
-				num_1s++;
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		nodeOf[i] = -1;
+	}
+	maxNode = -1;
+	dir = opendir("/sys/devices/system/node");
+	if (dir != NULL) {
+		while ((entry = readdir(dir)) != NULL) {
+			if (sscanf(entry->d_name, "node%d", &node) == 1 && node > maxNode) {
+				maxNode = node;
 			}
-			state->epsilon[thread_state->thread_id][i] = (BitSequence) bit;
 		}
+		closedir(dir);
 	}
 
 	/*
-	 * Write stats to freq.txt if in legacy_output mode
+	 * List the allowed CPUs of each node
 	 */
-	if (state->legacy_output == true) {
-		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
-		if (io_ret <= 0) {
-			errp(225, __func__, "error in writing to %s", state->freqFilePath);
+	count = 0;
+	for (node = 0; node <= maxNode; node++) {
+		snprintf(path, PATH_MAX + 1, "/sys/devices/system/node/node%d/cpulist", node);
+		cpulist = fopen(path, "r");
+		if (cpulist == NULL) {
+			continue;
 		}
-		io_ret = fflush(state->freqFile);
-		if (io_ret != 0) {
-			errp(225, __func__, "error flushing to %s", state->freqFilePath);
+		while (fscanf(cpulist, "%d", &first) == 1) {
+			last = first;
+			if (fscanf(cpulist, "-%d", &last) != 1) {
+				last = first;
+			}
+			for (i = MAX(first, 0); i <= last && i < CPU_SETSIZE; i++) {
+				nodeOf[i] = node;
+			}
+			if (fgetc(cpulist) != ',') {
+				break;
+			}
+		}
+		fclose(cpulist);
+
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (nodeOf[i] == node && CPU_ISSET(i, allowed)) {
+				order[count++] = i;
+			}
 		}
 	}
 
-	return;
+	/*
+	 * List the CPUs of unknown node
+	 */
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (nodeOf[i] < 0 && CPU_ISSET(i, allowed)) {
+			order[count++] = i;
+		}
+	}
+	return count;
 }
 
 
 /*
- * parseBitsBinaryInput - read bits from the streamFile and convert them into epsilon bit array
+ * pinThread - set the CPUs on which a thread about to be created will run
  *
  * given:
- *      state           // pointer to run state
+ *      state           // run state
+ *      attr            // attributes with which the thread will be created
+ *      thread_id       // the thread about to be created
  *
- * Given the open steam streamFile, from file state->randomDataPath, convert its bytes into 'bits'
- * found in the epsilon bit array.
+ * Test threads are pinned to a CPU each, taken in turn from the CPUs on which we are allowed to run
+ * as listed by orderCPUsByNode().  When there are more test threads than CPUs, the CPUs are reused from
+ * the first one.  Prefetch reader threads may run on any allowed CPU.
  */
 static void
-parseBitsBinaryInput(struct thread_state *thread_state)
+pinThread(struct state *state, pthread_attr_t *attr, long int thread_id)
 {
-	long int num_0s;	// Count of 0 bits processed
-	long int num_1s;	// Count of 1 bits processed
-	long int bitsRead;	// Number of bits to read and process
-	bool done;		// true ==> we have converted enough data
-	BYTE byte;		// single bite
-	int io_ret;		// I/O return status
+	cpu_set_t allowed;	// CPUs on which this process may run
+	cpu_set_t chosen;	// CPUs on which the thread will run
+	int cpu[CPU_SETSIZE];	// The allowed CPUs, in the order they are to be used
+	int nodeOf[CPU_SETSIZE];	// NUMA node of each CPU, or -1
+	int cpuCount;		// Number of allowed CPUs
+	char list[BUFSIZ + 1];	// The chosen CPUs, for debugging
+	size_t len;		// Length of the string in list
+	int io_ret;		// pthread return status
+	int i;
 
 	/*
 	 * Check preconditions (firewall)
 	 */
-	if (thread_state == NULL) {
-		err(225, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
 	if (state == NULL) {
-		err(226, __func__, "state arg is NULL");
+		err(242, __func__, "state arg is NULL");
 	}
-	if (state->streamFile == NULL) {
-		err(226, __func__, "streamFile arg is NULL");
+	if (attr == NULL) {
+		err(242, __func__, "attr arg is NULL");
 	}
 
 	/*
-	 * If not reading randdata from stdin,
-	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 * List the CPUs on which we are allowed to run
 	 */
-	if (state->stdinData == false &&
-	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n /
-							BITS_N_BYTE, SEEK_SET) != 0) {
-
-		errp(226, __func__, "could not seek %ld further into file: %s",
-		     thread_state->iteration_being_done * state->tp.n / BITS_N_BYTE, state->randomDataPath);
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		errp(242, __func__, "error on sched_getaffinity()");
+	}
+	cpuCount = orderCPUsByNode(&allowed, cpu, nodeOf);
+	if (cpuCount <= 0) {
+		err(242, __func__, "sched_getaffinity() found no CPU on which to run");
 	}
 
 	/*
-	 * Copy the next n bits from the streamFile to epsilon
+	 * Choose the CPUs of the thread
 	 */
-	num_0s = 0;
-	num_1s = 0;
-	bitsRead = 0;
-	clearerr(state->streamFile);
-	do {
-		/*
-		 * Read the next binary octet
-		 */
-		io_ret = fgetc(state->streamFile);
-		if (ferror(state->streamFile)) {
-			errp(226, __func__, "read error while reading file: %s", state->randomDataPath);
-		} else if (feof(state->streamFile) || io_ret == EOF) {
-			err(226, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
-			    state->randomDataPath, bitsRead);
-		} else if (io_ret < 0) {
-			errp(226, __func__, "unexpected fgetc return while reading file: %s", state->randomDataPath);
-		}
-		byte = (BYTE) io_ret;
-
-		/*
-		 * Add bits of the octet to the epsilon bit stream
-		 */
-		done = copyBitsToEpsilon(state, thread_state->thread_id, &byte, BITS_N_BYTE, &num_0s, &num_1s, &bitsRead);
-	} while (done == false);
+	if (thread_id >= state->numberOfThreads) {
+		chosen = allowed;
+	} else {
+		CPU_ZERO(&chosen);
+		CPU_SET(cpu[thread_id % cpuCount], &chosen);
+	}
+	io_ret = pthread_attr_setaffinity_np(attr, sizeof(chosen), &chosen);
+	if (io_ret != 0) {
+		errno = io_ret;
+		errp(242, __func__, "error on pthread_attr_setaffinity_np() for thread %ld", thread_id);
+	}
 
 	/*
-	 * Write stats to freq.txt if in legacy_output mode
+	 * Report the placement chosen
 	 */
-	if (state->legacy_output == true) {
-		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
-		if (io_ret <= 0) {
-			errp(226, __func__, "error in writing to %s", state->freqFilePath);
-		}
-		io_ret = fflush(state->freqFile);
-		if (io_ret != 0) {
-			errp(226, __func__, "error flushing to %s", state->freqFilePath);
+	list[0] = '\0';
+	len = 0;
+	for (i = 0; i < CPU_SETSIZE && len < BUFSIZ; i++) {
+		if (CPU_ISSET(i, &chosen)) {
+			len += (size_t) snprintf(list + len, BUFSIZ + 1 - len, " %d(node %d)", i, nodeOf[i]);
 		}
 	}
-
+	dbg(DBG_LOW, "%s thread %ld will run on CPUs:%s", (thread_id < state->numberOfThreads ? "test" : "reader"),
+	    thread_id, list);
 	return;
 }
 
 
 /*
- * copyBitsToEpsilon - convert binary bytes into the end of an epsilon bit array
+ * placeThreadBuffers - have a pinned test thread allocate its own working buffers
  *
  * given:
- *      state           // pointer to run state
- *      x               // pointer to an array (even just 1) binary bytes
- *      xBitLength      // Number of bits to convert
- *      bitsNeeded      // Total number of bits we want to convert this run
- *      num_0s          // pointer to number of 0 bits converted so far
- *      num_1s          // pointer to number of 1 bits converted so far
- *      bitsRead        // pointer to number of bits converted so far
+ *      thread_state    // pointer to thread state
  *
- * returns:
- *      true ==> we have converted enough bits
- *      false ==> we have NOT converted enough bits, yet
+ * Pages are placed on the NUMA node of the thread that first touches them, and malloc() serves
+ * each thread from its own arena.  The per thread buffers allocated by init() in the main thread
+ * may thus lie on a remote node, so a pinned test thread replaces its overlapping pattern counts
+ * and its scratch arena by ones that it allocates and zeroes itself.
+ *
+ * NOTE: The working buffers of the tests are all taken from the scratch arena (see scratchAlloc()), while
+ *       the packed bit buffers of the iterations are shared by the test threads (see task_graph).
  */
-bool
-copyBitsToEpsilon(struct state *state, long int thread_id, BYTE *x, long int xBitLength, long int *num_0s, long int *num_1s,
-		  long int *bitsRead)
+static void
+placeThreadBuffers(struct thread_state *thread_state)
 {
-	long int i;
-	long int j;
-	long int count;
-	int bit;
-	BYTE mask;
-	long int bitsNeeded;
+	long int thread_id;	// The pinned test thread
+	unsigned int cpu;	// CPU on which the thread is running
+	unsigned int node;	// NUMA node of that CPU
+	void *buf;		// The buffer that replaces one allocated by init()
+	size_t size;		// Size in bytes of that buffer
+	int io_ret;		// posix_memalign() return status
 
 	/*
 	 * Check preconditions (firewall)
 	 */
+	if (thread_state == NULL) {
+		err(243, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
 	if (state == NULL) {
-		err(227, __func__, "state arg is NULL");
+		err(243, __func__, "state arg is NULL");
 	}
-	if (state->epsilon[thread_id] == NULL) {
-		err(227, __func__, "state->epsilon[%ld] is NULL", thread_id);
+	thread_id = thread_state->thread_id;
+	if (state->patterns == NULL) {
+		err(243, __func__, "state->patterns is NULL");
 	}
 
-	bitsNeeded = state->tp.n;
+	/*
+	 * Replace the overlapping pattern counts, if any test needs them
+	 */
+	if (state->patterns[thread_id].count != NULL) {
+		size = ((size_t) 1 << state->patternWidth) * sizeof(state->patterns[thread_id].count[0]);
+		buf = malloc(size);
+		if (buf == NULL) {
+			errp(243, __func__, "cannot malloc of %lu bytes for patterns[%ld].count", size, thread_id);
+		}
+		memset(buf, 0, size);
+		free(state->patterns[thread_id].count);
+		state->patterns[thread_id].count = buf;
+	}
 
-	count = 0;
-	for (i = 0; i < (xBitLength + BITS_N_BYTE - 1) / BITS_N_BYTE; i++) {
-		mask = 0x80;
-		for (j = 0; j < 8; j++) {
-			if (*(x + i) & mask) {
-				bit = 1;
-				(*num_1s)++;
-			} else {
-				bit = 0;
-				(*num_0s)++;
+	/*
+	 * Replace the scratch arena, if any test reserved room in it
+	 */
+	if (state->scratch != NULL && state->scratch[thread_id].base != NULL) {
+		io_ret = posix_memalign(&buf, SCRATCH_ALIGN, state->scratchSize);
+		if (io_ret != 0) {
+			errno = io_ret;
+			errp(243, __func__, "cannot posix_memalign %lu bytes for scratch[%ld].base", state->scratchSize,
+			     thread_id);
+		}
+		memset(buf, 0, state->scratchSize);
+		free(state->scratch[thread_id].base);
+		state->scratch[thread_id].base = buf;
+	}
+
+	/*
+	 * Report where the thread and its buffers ended up
+	 */
+	if (getcpu(&cpu, &node) == 0) {
+		dbg(DBG_LOW, "test thread %ld is running on CPU %u of NUMA node %u", thread_id, cpu, node);
+	} else {
+		dbg(DBG_LOW, "test thread %ld is running on an unknown CPU", thread_id);
+	}
+	return;
+}
+#endif /* __linux__ */
+
+
+/*
+ * testBits - test thread that runs (iteration, test) tasks until every test of every iteration is done
+ *
+ * given:
+ *      thread_args     // pointer to thread state of this test thread
+ */
+static void
+*testBits(void *thread_args)
+{
+	struct thread_state *thread_state = (struct thread_state *) thread_args;
+	struct test_task task;	// Task being run by this thread
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(225, __func__, "state arg is NULL");
+	}
+	if (thread_state->graph == NULL) {
+		err(225, __func__, "graph is NULL");
+	}
+
+	dbg(DBG_HIGH, "Thread %ld started.", thread_state->thread_id);
+
+	/*
+	 * Place the buffers used for every iteration on the NUMA node of this thread, if it is pinned
+	 */
+#if defined(__linux__)
+	if (state->pinThreadsFlag == true) {
+		placeThreadBuffers(thread_state);
+	}
+#endif /* __linux__ */
+
+	/*
+	 * Open a private file descriptor if this thread reads its iterations with pread()
+	 */
+	if (thread_state->ring == NULL && state->readMode == READ_PREAD) {
+		openPositionalInput(thread_state);
+	}
+
+	/*
+	 * Run tasks of our own iterations, or of the iterations of other threads, until none is left
+	 */
+	while (nextTask(thread_state, &task) == true) {
+		runTask(thread_state, &task);
+	}
+	state->packedEpsilon[thread_state->thread_id] = NULL;
+
+	/*
+	 * Close the private file descriptor, if any
+	 */
+	if (thread_state->inputFd >= 0) {
+		closePositionalInput(thread_state);
+	}
+
+	pthread_exit((void *) thread_state->thread_id);
+}
+
+
+/*
+ * createTaskGraph - allocate the deques and iteration buffers shared by the test threads
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * returns:
+ *      task graph with 2 * state->numberOfThreads free iteration buffers, each of PACKED_WORDS(state->tp.n) words
+ *
+ * NOTE: This function must be called after the init functions, which may disable tests.
+ *
+ * This function does not return on error.
+ */
+static struct task_graph *
+createTaskGraph(struct state *state)
+{
+	struct task_graph *graph;	// Graph to setup
+	long int i;
+	int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(247, __func__, "state arg is NULL");
+	}
+	if (state->numberOfThreads <= 0) {
+		err(247, __func__, "state->numberOfThreads: %ld must be > 0", state->numberOfThreads);
+	}
+
+	/*
+	 * Allocate the graph
+	 */
+	graph = calloc(1, sizeof(*graph));
+	if (graph == NULL) {
+		errp(247, __func__, "cannot calloc task graph of %lu bytes", sizeof(*graph));
+	}
+	graph->threads = state->numberOfThreads;
+	for (j = 1; j <= NUMOFTESTS; j++) {
+		if (state->testVector[j] == true) {
+			graph->tests[graph->testCount++] = j;
+		}
+	}
+
+	/*
+	 * Allocate the iteration buffers, all initially free
+	 *
+	 * Each test thread may thus have an iteration of its own being tested while it loads the next one.
+	 */
+	graph->maxLoaded = 2 * graph->threads;
+	graph->loaded = calloc((size_t) graph->maxLoaded, sizeof(*graph->loaded));
+	if (graph->loaded == NULL) {
+		errp(247, __func__, "cannot calloc for loaded: %ld elements of %lu bytes each", graph->maxLoaded,
+		     sizeof(*graph->loaded));
+	}
+	graph->free = calloc((size_t) graph->maxLoaded, sizeof(*graph->free));
+	if (graph->free == NULL) {
+		errp(247, __func__, "cannot calloc for free: %ld elements of %lu bytes each", graph->maxLoaded,
+		     sizeof(*graph->free));
+	}
+	for (i = 0; i < graph->maxLoaded; i++) {
+		graph->loaded[i].iteration = -1;
+		graph->loaded[i].bits = calloc((size_t) PACKED_WORDS(state->tp.n), sizeof(WORD64));
+		if (graph->loaded[i].bits == NULL) {
+			errp(247, __func__, "cannot calloc for loaded[%ld].bits: %ld elements of %lu bytes each", i,
+			     PACKED_WORDS(state->tp.n), sizeof(WORD64));
+		}
+		graph->free[graph->freeCount++] = &graph->loaded[i];
+	}
+
+	/*
+	 * Allocate the deques, each large enough for the tasks of every loaded iteration
+	 */
+	graph->capacity = MAX(1, graph->maxLoaded * graph->testCount);
+	graph->deque = calloc((size_t) graph->threads, sizeof(*graph->deque));
+	if (graph->deque == NULL) {
+		errp(247, __func__, "cannot calloc for deque: %ld elements of %lu bytes each", graph->threads,
+		     sizeof(*graph->deque));
+	}
+	graph->head = calloc((size_t) graph->threads, sizeof(*graph->head));
+	if (graph->head == NULL) {
+		errp(247, __func__, "cannot calloc for head: %ld elements of %lu bytes each", graph->threads,
+		     sizeof(*graph->head));
+	}
+	graph->count = calloc((size_t) graph->threads, sizeof(*graph->count));
+	if (graph->count == NULL) {
+		errp(247, __func__, "cannot calloc for count: %ld elements of %lu bytes each", graph->threads,
+		     sizeof(*graph->count));
+	}
+	for (i = 0; i < graph->threads; i++) {
+		graph->deque[i] = calloc((size_t) graph->capacity, sizeof(*graph->deque[i]));
+		if (graph->deque[i] == NULL) {
+			errp(247, __func__, "cannot calloc for deque[%ld]: %ld elements of %lu bytes each", i,
+			     graph->capacity, sizeof(*graph->deque[i]));
+		}
+	}
+
+	/*
+	 * Allocate the stack of block shares, large enough for all but the first share of each test thread
+	 */
+	graph->share = calloc((size_t) (graph->threads * state->blockThreads), sizeof(*graph->share));
+	if (graph->share == NULL) {
+		errp(247, __func__, "cannot calloc for share: %ld elements of %lu bytes each",
+		     graph->threads * state->blockThreads, sizeof(*graph->share));
+	}
+
+	/*
+	 * Setup the graph synchronization
+	 */
+	if (pthread_mutex_init(&graph->lock, NULL) != 0) {
+		errp(247, __func__, "error on pthread_mutex_init()");
+	}
+	if (pthread_cond_init(&graph->wake, NULL) != 0) {
+		errp(247, __func__, "error on pthread_cond_init()");
+	}
+
+	return graph;
+}
+
+
+/*
+ * destroyTaskGraph - free the task graph and its iteration buffers
+ *
+ * given:
+ *      graph           // task graph to free, after all test threads have been joined
+ */
+static void
+destroyTaskGraph(struct task_graph *graph)
+{
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (graph == NULL) {
+		err(247, __func__, "graph arg is NULL");
+	}
+	if (graph->queued != 0 || graph->freeCount != graph->maxLoaded || graph->shareCount != 0) {
+		err(247, __func__, "task graph still has %ld queued tasks, %ld block shares and only %ld of %ld free buffers",
+		    graph->queued, graph->shareCount, graph->freeCount, graph->maxLoaded);
+	}
+
+	for (i = 0; i < graph->threads; i++) {
+		free(graph->deque[i]);
+		graph->deque[i] = NULL;
+	}
+	free(graph->deque);
+	free(graph->head);
+	free(graph->count);
+	for (i = 0; i < graph->maxLoaded; i++) {
+		free(graph->loaded[i].bits);
+		graph->loaded[i].bits = NULL;
+	}
+	free(graph->loaded);
+	free(graph->free);
+	free(graph->share);
+	pthread_cond_destroy(&graph->wake);
+	pthread_mutex_destroy(&graph->lock);
+	free(graph);
+
+	return;
+}
+
+
+/*
+ * nextTask - find the next task for a test thread to run
+ *
+ * given:
+ *      thread_state    // pointer to thread state of a test thread
+ *      task            // where to put the task found
+ *
+ * returns:
+ *      true ==> task was taken off a deque, and is to be run with runTask()
+ *      false ==> every iteration has been loaded and every task has been taken
+ *
+ * In order of preference, the thread works on a block share published by runBlocks(), takes the newest
+ * task of its own deque, loads the next iteration if a buffer is free and queues its tasks on its own
+ * deque, or steals the oldest task of another thread.  When none of these is possible, the thread waits
+ * for work to be queued or for a buffer to be freed.  Thus threads keep to their own iterations, and only
+ * steal when the iterations run out.  As long as a task is running it may still publish block shares, so
+ * the thread only stops once no task is left running.
+ *
+ * This function does not return on error.
+ */
+static bool
+nextTask(struct thread_state *thread_state, struct test_task *task)
+{
+	struct task_graph *graph;	// Tasks shared among the test threads
+	struct loaded_iteration *loaded;	// Buffer into which the next iteration is loaded
+	long int self;			// Index of the deque of this thread
+	long int victim;		// Index of a deque to steal from
+	long int tail;			// Index in a deque past its newest task
+	bool more;			// true ==> an iteration was loaded
+	long int k;
+	int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(248, __func__, "thread_state arg is NULL");
+	}
+	if (task == NULL) {
+		err(248, __func__, "task arg is NULL");
+	}
+	graph = thread_state->graph;
+	if (graph == NULL) {
+		err(248, __func__, "graph is NULL");
+	}
+	self = thread_state->thread_id;
+	if (self < 0 || self >= graph->threads) {
+		err(248, __func__, "thread_id: %ld must be in the range [0-%ld]", self, graph->threads - 1);
+	}
+
+	pthread_mutex_lock(&graph->lock);
+	for (;;) {
+
+		/*
+		 * Help the test that published a block share finish its iteration
+		 */
+		if (graph->shareCount > 0) {
+			runShare(thread_state, graph);
+			continue;
+		}
+
+		/*
+		 * Take the newest task of our own deque, i.e., the next test of the iteration we loaded last
+		 */
+		if (graph->count[self] > 0) {
+			graph->count[self]--;
+			*task = graph->deque[self][(graph->head[self] + graph->count[self]) % graph->capacity];
+			graph->queued--;
+			graph->running++;
+			pthread_mutex_unlock(&graph->lock);
+			return true;
+		}
+
+		/*
+		 * Load the next iteration into a free buffer, and queue its tests on our own deque
+		 *
+		 * The tests are queued in reverse order so that we take them in test order,
+		 * while other threads steal the last tests first.
+		 */
+		if (graph->exhausted == false && graph->freeCount > 0) {
+			loaded = graph->free[--graph->freeCount];
+			graph->loading++;
+			pthread_mutex_unlock(&graph->lock);
+
+			more = loadIteration(thread_state, loaded);
+
+			pthread_mutex_lock(&graph->lock);
+			graph->loading--;
+			if (more == true && graph->testCount > 0) {
+				loaded->pending = graph->testCount;
+				for (j = graph->testCount - 1; j >= 0; j--) {
+					tail = (graph->head[self] + graph->count[self]) % graph->capacity;
+					graph->deque[self][tail].loaded = loaded;
+					graph->deque[self][tail].test = graph->tests[j];
+					graph->count[self]++;
+				}
+				graph->queued += graph->testCount;
+			} else {
+				graph->free[graph->freeCount++] = loaded;
+				if (more == false) {
+					graph->exhausted = true;
+				}
 			}
-			mask >>= 1;
-			state->epsilon[thread_id][*bitsRead] = (BitSequence) bit;
-			(*bitsRead)++;
-			if (*bitsRead == bitsNeeded) {
+			pthread_cond_broadcast(&graph->wake);
+			continue;
+		}
+
+		/*
+		 * Steal the oldest task of another thread
+		 */
+		for (k = 1; k < graph->threads; k++) {
+			victim = (self + k) % graph->threads;
+			if (graph->count[victim] > 0) {
+				*task = graph->deque[victim][graph->head[victim]];
+				graph->head[victim] = (graph->head[victim] + 1) % graph->capacity;
+				graph->count[victim]--;
+				graph->queued--;
+				graph->running++;
+				graph->steals++;
+				pthread_mutex_unlock(&graph->lock);
 				return true;
 			}
-			if (++count == xBitLength) {
-				return false;
-			}
 		}
+
+		/*
+		 * Stop once every iteration is loaded and every task is done, else wait for something to do
+		 */
+		if (graph->exhausted == true && graph->loading == 0 && graph->running == 0) {
+			pthread_mutex_unlock(&graph->lock);
+			return false;
+		}
+		graph->waits++;
+		pthread_cond_wait(&graph->wake, &graph->lock);
 	}
+}
 
-	return false;
+
+/*
+ * loadIteration - claim the next iteration and read its bits into an iteration buffer
+ *
+ * given:
+ *      thread_state    // pointer to thread state of a test thread
+ *      loaded          // free iteration buffer to load
+ *
+ * returns:
+ *      true ==> loaded holds the bits of loaded->iteration
+ *      false ==> all iterations have already been claimed
+ *
+ * Under -Q depth[,readers] the buffer is exchanged for the oldest filled buffer of the prefetch ring,
+ * so loaded->bits may change.
+ */
+static bool
+loadIteration(struct thread_state *thread_state, struct loaded_iteration *loaded)
+{
+	bool more;		// true ==> an iteration was read
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(249, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(249, __func__, "state arg is NULL");
+	}
+	if (loaded == NULL) {
+		err(249, __func__, "loaded arg is NULL");
+	}
+
+	/*
+	 * Obtain the bits of the next iteration, either from the prefetch ring or by reading them
+	 */
+	state->packedEpsilon[thread_state->thread_id] = loaded->bits;
+	if (thread_state->ring != NULL) {
+		more = takePrefetchedIteration(thread_state);
+	} else {
+		more = readNextIteration(thread_state);
+	}
+	loaded->bits = state->packedEpsilon[thread_state->thread_id];
+	if (more == true) {
+		loaded->iteration = thread_state->iteration_being_done;
+	}
+
+	return more;
+}
+
+
+/*
+ * runTask - run one test on one loaded iteration, and free the iteration buffer once all of its tests are done
+ *
+ * given:
+ *      thread_state    // pointer to thread state of a test thread
+ *      task            // task to run, as found by nextTask()
+ *
+ * This function does not return on error.
+ */
+static void
+runTask(struct thread_state *thread_state, struct test_task *task)
+{
+	struct task_graph *graph;	// Tasks shared among the test threads
+	struct loaded_iteration *loaded;	// Iteration to test
+	long int iteration;		// loaded->iteration
+	bool done;			// true ==> this was the last test of the iteration
+	char buf[BUFSIZ + 1];		// time string buffer
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(250, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(250, __func__, "state arg is NULL");
+	}
+	if (task == NULL || task->loaded == NULL) {
+		err(250, __func__, "task arg is NULL or has no loaded iteration");
+	}
+	graph = thread_state->graph;
+	if (graph == NULL) {
+		err(250, __func__, "graph is NULL");
+	}
+	loaded = task->loaded;
+	iteration = loaded->iteration;
+
+	/*
+	 * Test the bits of the iteration
+	 *
+	 * The random walk and the patterns of this thread are only kept while it tests the same iteration,
+	 * and the scratch arena is emptied for each test.
+	 */
+	state->packedEpsilon[thread_state->thread_id] = loaded->bits;
+	thread_state->iteration_being_done = iteration;
+	if (thread_state->cachedIteration != iteration) {
+		state->walk[thread_state->thread_id].valid = false;
+		state->patterns[thread_state->thread_id].valid = false;
+		thread_state->cachedIteration = iteration;
+	}
+	state->scratch[thread_state->thread_id].used = 0;
+	iterate(thread_state, task->test);
+	append_value(state->shard[thread_state->thread_id].iterations[task->test], &iteration);
+
+	/*
+	 * Free the iteration buffer once the last test of the iteration is done, and wake the idle threads
+	 * when the buffer is freed or when no task is left running (see nextTask())
+	 */
+	pthread_mutex_lock(&graph->lock);
+	loaded->pending--;
+	done = (loaded->pending == 0);
+	if (done == true) {
+		graph->free[graph->freeCount++] = loaded;
+	}
+	graph->running--;
+	if (done == true || graph->running == 0) {
+		pthread_cond_broadcast(&graph->wake);
+	}
+	pthread_mutex_unlock(&graph->lock);
+
+	/*
+	 * Report iteration done (if requested)
+	 */
+	if (done == true && state->reportCycle > 0 &&
+	    (((iteration % state->reportCycle) == 0) || (iteration == state->tp.numOfBitStreams))) {
+		getTimestamp(buf, BUFSIZ);
+		msg("Completed iteration %ld of %ld at %s", iteration + 1, state->tp.numOfBitStreams, buf);
+	}
+
+	return;
+}
+
+
+/*
+ * readNextIteration - claim the next iteration and read its bits into the packed bit stream of the thread
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * returns:
+ *      true ==> thread_state->iteration_being_done was read into state->packedEpsilon[thread_state->thread_id]
+ *      false ==> all iterations have already been claimed
+ */
+static bool
+readNextIteration(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(225, __func__, "state arg is NULL");
+	}
+
+	pthread_mutex_lock(thread_state->mutex);
+
+	if (state->iterationsMissing == 0) {
+		pthread_mutex_unlock(thread_state->mutex);
+		return false;
+	}
+
+	thread_state->iteration_being_done = state->tp.numOfBitStreams - state->iterationsMissing;
+	state->iterationsMissing -= 1;
+
+	/*
+	 * Parse and data for this iteration
+	 *
+	 * When randdata is memory mapped or read through a private file descriptor, each thread
+	 * reads its own slice of randdata, so the mutex only needs to be held while we claim the iteration.
+	 */
+	if (state->readMode == READ_MMAP) {
+		pthread_mutex_unlock(thread_state->mutex);
+		parseBitsMappedInput(thread_state);
+	} else if (state->readMode == READ_PREAD) {
+		pthread_mutex_unlock(thread_state->mutex);
+		parseBitsPositionalInput(thread_state);
+	} else {
+		if (state->dataFormat == FORMAT_ASCII_01) {
+			parseBitsASCIIInput(thread_state);
+		} else {
+			parseBitsBinaryInput(thread_state);
+		}
+		pthread_mutex_unlock(thread_state->mutex);
+	}
+
+	return true;
+}
+
+
+/*
+ * prefetchBits - reader thread that fills the prefetch ring ahead of the test threads
+ *
+ * given:
+ *      thread_args     // pointer to thread state of this reader thread
+ *
+ * A reader takes an empty buffer from the ring, makes it the packed bit stream of its own
+ * thread_id, reads the next iteration into it and queues it as full.  Readers claim iterations
+ * in the same way as test threads do without -Q, so data from standard input is still read in order.
+ */
+static void
+*prefetchBits(void *thread_args)
+{
+	struct thread_state *thread_state = (struct thread_state *) thread_args;
+	struct prefetch_ring *ring;	// Ring of iterations read ahead
+	WORD64 *buf;			// Buffer being filled
+	long int tail;			// Index in ring->full where to queue the filled buffer
+	bool more;			// true ==> an iteration was read into buf
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(212, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(212, __func__, "state arg is NULL");
+	}
+	ring = thread_state->ring;
+	if (ring == NULL) {
+		err(212, __func__, "ring is NULL");
+	}
+
+	dbg(DBG_HIGH, "Prefetch reader thread %ld started.", thread_state->thread_id);
+
+	/*
+	 * Open a private file descriptor if this thread reads its iterations with pread()
+	 */
+	if (state->readMode == READ_PREAD) {
+		openPositionalInput(thread_state);
+	}
+
+	do {
+		/*
+		 * Wait for a buffer to fill
+		 */
+		pthread_mutex_lock(&ring->lock);
+		if (ring->emptyCount == 0) {
+			ring->readerWaits++;
+			do {
+				pthread_cond_wait(&ring->notFull, &ring->lock);
+			} while (ring->emptyCount == 0);
+		}
+		buf = ring->empty[--ring->emptyCount];
+		pthread_mutex_unlock(&ring->lock);
+
+		/*
+		 * Read the next iteration into the buffer
+		 */
+		state->packedEpsilon[thread_state->thread_id] = buf;
+		more = readNextIteration(thread_state);
+		state->packedEpsilon[thread_state->thread_id] = NULL;
+
+		/*
+		 * Queue the filled buffer, or give the buffer back if there was nothing left to read
+		 */
+		pthread_mutex_lock(&ring->lock);
+		if (more == true) {
+			tail = (ring->fullHead + ring->fullCount) % ring->depth;
+			ring->full[tail] = buf;
+			ring->fullIteration[tail] = thread_state->iteration_being_done;
+			ring->fullCount++;
+			pthread_cond_signal(&ring->notEmpty);
+		} else {
+			ring->empty[ring->emptyCount++] = buf;
+		}
+		pthread_mutex_unlock(&ring->lock);
+	} while (more == true);
+
+	/*
+	 * Tell the test threads when the last reader is done
+	 */
+	pthread_mutex_lock(&ring->lock);
+	ring->readersActive--;
+	if (ring->readersActive == 0) {
+		pthread_cond_broadcast(&ring->notEmpty);
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	/*
+	 * Close the private file descriptor, if any
+	 */
+	if (thread_state->inputFd >= 0) {
+		closePositionalInput(thread_state);
+	}
+
+	dbg(DBG_HIGH, "Prefetch reader thread %ld done.", thread_state->thread_id);
+	pthread_exit((void *) thread_state->thread_id);
+}
+
+
+/*
+ * takePrefetchedIteration - exchange the packed bit stream of a test thread for the oldest filled ring buffer
+ *
+ * given:
+ *      thread_state    // pointer to thread state of a test thread
+ *
+ * returns:
+ *      true ==> state->packedEpsilon[thread_state->thread_id] holds thread_state->iteration_being_done
+ *      false ==> the readers are done and no filled buffer is left
+ *
+ * The buffer that the test thread has just finished with goes back to the ring to be filled again.
+ */
+static bool
+takePrefetchedIteration(struct thread_state *thread_state)
+{
+	struct prefetch_ring *ring;	// Ring of iterations read ahead
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(212, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(212, __func__, "state arg is NULL");
+	}
+	ring = thread_state->ring;
+	if (ring == NULL) {
+		err(212, __func__, "ring is NULL");
+	}
+
+	/*
+	 * Wait for a filled buffer, unless all readers are done
+	 */
+	pthread_mutex_lock(&ring->lock);
+	if (ring->fullCount == 0 && ring->readersActive > 0) {
+		ring->workerWaits++;
+		do {
+			pthread_cond_wait(&ring->notEmpty, &ring->lock);
+		} while (ring->fullCount == 0 && ring->readersActive > 0);
+	}
+	if (ring->fullCount == 0) {
+		pthread_mutex_unlock(&ring->lock);
+		return false;
+	}
+
+	/*
+	 * Swap our buffer for the oldest filled one
+	 */
+	ring->empty[ring->emptyCount++] = state->packedEpsilon[thread_state->thread_id];
+	state->packedEpsilon[thread_state->thread_id] = ring->full[ring->fullHead];
+	thread_state->iteration_being_done = ring->fullIteration[ring->fullHead];
+	ring->fullHead = (ring->fullHead + 1) % ring->depth;
+	ring->fullCount--;
+	pthread_cond_signal(&ring->notFull);
+	pthread_mutex_unlock(&ring->lock);
+
+	return true;
+}
+
+
+/*
+ * createPrefetchRing - allocate the prefetch ring and its spare packed bit buffers
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * returns:
+ *      ring with state->prefetchDepth empty buffers, each of PACKED_WORDS(state->tp.n) words
+ *
+ * This function does not return on error.
+ */
+static struct prefetch_ring *
+createPrefetchRing(struct state *state)
+{
+	struct prefetch_ring *ring;	// Ring to setup
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(212, __func__, "state arg is NULL");
+	}
+	if (state->prefetchDepth <= 0) {
+		err(212, __func__, "prefetchDepth: %ld must be > 0", state->prefetchDepth);
+	}
+	if (state->prefetchReaders <= 0) {
+		err(212, __func__, "prefetchReaders: %ld must be > 0", state->prefetchReaders);
+	}
+
+	/*
+	 * Allocate the ring
+	 */
+	ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		errp(212, __func__, "cannot calloc prefetch ring of %lu bytes", sizeof(*ring));
+	}
+	ring->depth = state->prefetchDepth;
+	ring->readersActive = state->prefetchReaders;
+	ring->full = calloc((size_t) ring->depth, sizeof(*ring->full));
+	if (ring->full == NULL) {
+		errp(212, __func__, "cannot calloc for full: %ld elements of %lu bytes each", ring->depth, sizeof(*ring->full));
+	}
+	ring->fullIteration = calloc((size_t) ring->depth, sizeof(*ring->fullIteration));
+	if (ring->fullIteration == NULL) {
+		errp(212, __func__, "cannot calloc for fullIteration: %ld elements of %lu bytes each", ring->depth,
+		     sizeof(*ring->fullIteration));
+	}
+	ring->empty = calloc((size_t) ring->depth, sizeof(*ring->empty));
+	if (ring->empty == NULL) {
+		errp(212, __func__, "cannot calloc for empty: %ld elements of %lu bytes each", ring->depth,
+		     sizeof(*ring->empty));
+	}
+
+	/*
+	 * Allocate the spare packed bit buffers, all initially waiting to be filled
+	 */
+	for (i = 0; i < ring->depth; i++) {
+		ring->empty[i] = calloc((size_t) PACKED_WORDS(state->tp.n), sizeof(WORD64));
+		if (ring->empty[i] == NULL) {
+			errp(212, __func__, "cannot calloc for empty[%ld]: %ld elements of %lu bytes each", i,
+			     PACKED_WORDS(state->tp.n), sizeof(WORD64));
+		}
+	}
+	ring->emptyCount = ring->depth;
+
+	/*
+	 * Setup the ring synchronization
+	 */
+	if (pthread_mutex_init(&ring->lock, NULL) != 0) {
+		errp(212, __func__, "error on pthread_mutex_init()");
+	}
+	if (pthread_cond_init(&ring->notEmpty, NULL) != 0) {
+		errp(212, __func__, "error on pthread_cond_init()");
+	}
+	if (pthread_cond_init(&ring->notFull, NULL) != 0) {
+		errp(212, __func__, "error on pthread_cond_init()");
+	}
+
+	return ring;
+}
+
+
+/*
+ * destroyPrefetchRing - free the prefetch ring and its spare packed bit buffers
+ *
+ * given:
+ *      ring            // prefetch ring to free, after all threads have been joined
+ */
+static void
+destroyPrefetchRing(struct prefetch_ring *ring)
+{
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (ring == NULL) {
+		err(212, __func__, "ring arg is NULL");
+	}
+	if (ring->fullCount != 0 || ring->emptyCount != ring->depth) {
+		err(212, __func__, "prefetch ring still has %ld filled buffers and only %ld of %ld empty buffers",
+		    ring->fullCount, ring->emptyCount, ring->depth);
+	}
+
+	for (i = 0; i < ring->emptyCount; i++) {
+		free(ring->empty[i]);
+		ring->empty[i] = NULL;
+	}
+	free(ring->empty);
+	free(ring->full);
+	free(ring->fullIteration);
+	pthread_cond_destroy(&ring->notFull);
+	pthread_cond_destroy(&ring->notEmpty);
+	pthread_mutex_destroy(&ring->lock);
+	free(ring);
+
+	return;
+}
+
+
+/*
+ * parseBitsASCIIInput - read bits from the streamFile and save them into the packed bit stream
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * Given the open steam streamFile, from file state->randomDataPath, convert its ASCII characters
+ * into bits of the packed bit stream of this thread.
+ */
+static void
+parseBitsASCIIInput(struct thread_state *thread_state)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	long int bitsRead;	// Number of bits read and processed
+	long int want;		// Number of characters to read into buf
+	long int got;		// Number of characters read by fread()
+	long int used;		// Number of characters consumed by decodeASCIIBits()
+	BYTE buf[BUFSIZ];	// block of ASCII characters read from streamFile
+	WORD64 *packed;		// Packed bit stream of this thread
+	int io_ret;		// I/O return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(225, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(225, __func__, "streamFile arg is NULL");
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(227, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	packed = state->packedEpsilon[thread_state->thread_id];
+
+	/*
+	 * If not reading randdata from stdin,
+	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 */
+	if (state->stdinData == false &&
+	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n, SEEK_SET) != 0) {
+		errp(226, __func__, "could not seek %ld further into file: %s",
+		     (thread_state->iteration_being_done * state->tp.n), state->randomDataPath);
+	}
+
+	/*
+	 * Decode the next n bits from the streamFile into the packed bit stream
+	 *
+	 * We never ask for more characters than bits still needed, so when reading from stdin we never
+	 * consume characters that belong to the next iteration.  Each block is short only by the whitespace it skipped.
+	 */
+	num_1s = 0;
+	bitsRead = 0;
+	clearerr(state->streamFile);
+	while (bitsRead < state->tp.n) {
+		want = state->tp.n - bitsRead;
+		if (want > (long int) sizeof(buf)) {
+			want = (long int) sizeof(buf);
+		}
+		got = (long int) fread(buf, sizeof(BYTE), (size_t) want, state->streamFile);
+		if (got <= 0) {
+			if (ferror(state->streamFile)) {
+				errp(225, __func__, "read error while reading file: %s", state->randomDataPath);
+			}
+			warn(__func__, "Insufficient data in file %s: %ld bits were read", state->randomDataPath,
+			     bitsRead);
+			return;
+		}
+		bitsRead += decodeASCIIBits(buf, got, packed, bitsRead, state->tp.n - bitsRead, &used, &num_1s);
+		if (used < got) {
+			err(225, __func__, "invalid character 0x%02x in ASCII data of file %s after %ld bits were read",
+			    (unsigned int) buf[used], state->randomDataPath, bitsRead);
+		}
+	}
+	num_0s = bitsRead - num_1s;
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	if (state->legacy_output == true) {
+		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
+		if (io_ret <= 0) {
+			errp(225, __func__, "error in writing to %s", state->freqFilePath);
+		}
+		io_ret = fflush(state->freqFile);
+		if (io_ret != 0) {
+			errp(225, __func__, "error flushing to %s", state->freqFilePath);
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * reverseBits - each byte value with the order of its bits reversed
+ *
+ * A byte compare mask has the bit of the first character least significant, while a packed
+ * bit stream holds its first bit most significant.  The table is built at compile time.
+ */
+#if defined(__AVX2__) || defined(__SSE2__)
+#define REVERSE_2(b) (b), (b) + 2 * 64, (b) + 1 * 64, (b) + 3 * 64
+#define REVERSE_4(b) REVERSE_2(b), REVERSE_2((b) + 2 * 16), REVERSE_2((b) + 1 * 16), REVERSE_2((b) + 3 * 16)
+#define REVERSE_6(b) REVERSE_4(b), REVERSE_4((b) + 2 * 4), REVERSE_4((b) + 1 * 4), REVERSE_4((b) + 3 * 4)
+static const BYTE reverseBits[256] = {
+	REVERSE_6(0), REVERSE_6(2), REVERSE_6(1), REVERSE_6(3)
+};
+#undef REVERSE_6
+#undef REVERSE_4
+#undef REVERSE_2
+#endif
+
+
+/*
+ * decodeASCIIBits - decode ASCII '0' and '1' characters into a packed bit stream
+ *
+ * given:
+ *      src             // ASCII characters to decode
+ *      srcLen          // number of characters in src
+ *      dst             // packed bit stream into which to write the decoded bits
+ *      first           // bit of dst at which to write the first decoded bit
+ *      bitsNeeded      // maximum number of bits to write into dst
+ *      used            // where to return the number of characters of src consumed
+ *      num_1s          // pointer to the count of 1 bits processed, incremented by this function
+ *
+ * returns:
+ *      number of bits written into dst
+ *
+ * Whitespace characters between bits are skipped.  Decoding stops after bitsNeeded bits,
+ * at the end of src, or at the first character that is neither a bit nor whitespace.  If on
+ * return *used < srcLen and fewer than bitsNeeded bits were written, src[*used] is that invalid character.
+ *
+ * The bits of dst before first are kept and the rest of the word holding the last decoded bit is zeroed,
+ * so an iteration may be decoded one block of characters at a time.
+ *
+ * The bulk of the data is expected to be runs of '0' and '1' characters.  These are decoded
+ * 32 (AVX2) or 16 (SSE2) characters at a time when the compiler targets those instruction
+ * sets, and 8 characters at a time in a 64-bit word otherwise.  Only blocks that contain
+ * whitespace or invalid characters fall back to the character by character loop.
+ */
+static long int
+decodeASCIIBits(BYTE const *src, long int srcLen, WORD64 *dst, long int first, long int bitsNeeded, long int *used,
+		long int *num_1s)
+{
+	long int i;		// Index into src
+	long int bits;		// Number of bits written into dst
+	long int ones;		// Number of 1 bits written into dst
+	WORD64 *out;		// Word of dst that the bits in acc belong to
+	WORD64 acc;		// Bits decoded into the word at out so far, the last one least significant
+	int accBits;		// Number of bits in acc
+	int spill;		// Number of decoded bits that belong to the word after out
+	WORD64 word;		// 8 characters of src
+	BYTE c;			// Single character of src
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (src == NULL) {
+		err(225, __func__, "src arg is NULL");
+	}
+	if (dst == NULL) {
+		err(225, __func__, "dst arg is NULL");
+	}
+	if (used == NULL) {
+		err(225, __func__, "used arg is NULL");
+	}
+	if (num_1s == NULL) {
+		err(225, __func__, "num_1s arg is NULL");
+	}
+
+	/*
+	 * Pick up the bits already in the word that holds bit first
+	 */
+	out = dst + first / BITS_N_WORD64;
+	accBits = (int) (first % BITS_N_WORD64);
+	acc = (accBits > 0 ? *out >> (BITS_N_WORD64 - accBits) : 0);
+
+	/*
+	 * Add the k (1 <= k <= 32) bits of v after those in acc, storing each word of dst once it is full
+	 */
+#define ADD_BITS(v, k) do { \
+		if (accBits + (k) < BITS_N_WORD64) { \
+			acc = (acc << (k)) | (WORD64) (v); \
+			accBits += (k); \
+		} else { \
+			spill = accBits + (k) - BITS_N_WORD64; \
+			*out++ = (acc << (BITS_N_WORD64 - accBits)) | ((WORD64) (v) >> spill); \
+			acc = (WORD64) (v) & (((WORD64) 1 << spill) - 1); \
+			accBits = spill; \
+		} \
+	} while (0)
+
+	i = 0;
+	bits = 0;
+	ones = 0;
+	while (i < srcLen && bits < bitsNeeded) {
+
+#if defined(__AVX2__)
+		/*
+		 * Decode 32 characters at a time when they are all '0' or '1'
+		 */
+		while (srcLen - i >= 32 && bitsNeeded - bits >= 32) {
+			__m256i v = _mm256_loadu_si256((__m256i const *) (src + i));
+			__m256i isBit = _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8((char) 0xFE)),
+							  _mm256_set1_epi8('0'));
+			if (_mm256_movemask_epi8(isBit) != -1) {
+				break;
+			}
+			unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('1')));
+			ones += __builtin_popcount(mask);
+			ADD_BITS(((unsigned int) reverseBits[mask & 0xFF] << 24) |
+				 ((unsigned int) reverseBits[(mask >> 8) & 0xFF] << 16) |
+				 ((unsigned int) reverseBits[(mask >> 16) & 0xFF] << 8) | reverseBits[mask >> 24], 32);
+			i += 32;
+			bits += 32;
+		}
+#elif defined(__SSE2__)
+		/*
+		 * Decode 16 characters at a time when they are all '0' or '1'
+		 */
+		while (srcLen - i >= 16 && bitsNeeded - bits >= 16) {
+			__m128i v = _mm_loadu_si128((__m128i const *) (src + i));
+			__m128i isBit = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8((char) 0xFE)), _mm_set1_epi8('0'));
+			if (_mm_movemask_epi8(isBit) != 0xFFFF) {
+				break;
+			}
+			unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('1')));
+			ones += __builtin_popcount(mask);
+			ADD_BITS(((unsigned int) reverseBits[mask & 0xFF] << 8) | reverseBits[mask >> 8], 16);
+			i += 16;
+			bits += 16;
+		}
+#endif
+
+		/*
+		 * Decode 8 characters at a time when they are all '0' or '1'
+		 *
+		 * '0' is 0x30 and '1' is 0x31, so a byte is a bit character exactly when all but its
+		 * lowest bit equals 0x30.  Subtracting 0x30 from every byte cannot borrow across bytes.
+		 * With the first character in the lowest byte, multiplying by 0x8040201008040201 moves
+		 * the bit of character k to bit 63 - k without any carry, so the top byte holds the 8 bits in order.
+		 */
+		while (srcLen - i >= 8 && bitsNeeded - bits >= 8) {
+			memcpy(&word, src + i, sizeof(word));
+			if ((word & UINT64_C(0xFEFEFEFEFEFEFEFE)) != UINT64_C(0x3030303030303030)) {
+				break;
+			}
+			word -= UINT64_C(0x3030303030303030);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			word = __builtin_bswap64(word);
+#endif
+			ones += (long int) ((word * UINT64_C(0x0101010101010101)) >> 56);
+			ADD_BITS((word * UINT64_C(0x8040201008040201)) >> 56, 8);
+			i += 8;
+			bits += 8;
+		}
+
+		/*
+		 * Decode a single character, skipping whitespace
+		 */
+		if (i >= srcLen || bits >= bitsNeeded) {
+			break;
+		}
+		c = src[i];
+		if (c == '0' || c == '1') {
+			ADD_BITS(c - '0', 1);
+			++bits;
+			ones += c - '0';
+		} else if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '\v' && c != '\f') {
+			break;
+		}
+		++i;
+	}
+#undef ADD_BITS
+
+	/*
+	 * Store the bits of the last partly filled word
+	 */
+	if (accBits > 0) {
+		*out = acc << (BITS_N_WORD64 - accBits);
+	}
+
+	/*
+	 * Skip any whitespace that follows the last bit so that it is not reported as unused
+	 */
+	while (i < srcLen && (src[i] == ' ' || src[i] == '\t' || src[i] == '\n' || src[i] == '\r' ||
+			      src[i] == '\v' || src[i] == '\f')) {
+		++i;
+	}
+
+	*used = i;
+	*num_1s += ones;
+	return bits;
+}
+
+/*
+ * parseBitsBinaryInput - read bits from the streamFile into the packed bit stream
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * Given the open steam streamFile, from file state->randomDataPath, read its bytes straight into
+ * the packed bit stream of this thread and put them in word order with packBytes().
+ */
+static void
+parseBitsBinaryInput(struct thread_state *thread_state)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	BYTE *bytes;		// Bytes of the packed bit stream of this thread, in file order until packed
+	long int byteCount;	// Number of bytes that hold the bits of this iteration
+	long int have;		// Number of bytes read so far
+	long int got;		// Number of octets read by fread()
+	int io_ret;		// I/O return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(226, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(226, __func__, "streamFile arg is NULL");
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(226, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	bytes = (BYTE *) state->packedEpsilon[thread_state->thread_id];
+
+	/*
+	 * If not reading randdata from stdin,
+	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 */
+	if (state->stdinData == false &&
+	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n /
+							BITS_N_BYTE, SEEK_SET) != 0) {
+
+		errp(226, __func__, "could not seek %ld further into file: %s",
+		     thread_state->iteration_being_done * state->tp.n / BITS_N_BYTE, state->randomDataPath);
+	}
+
+	/*
+	 * Read the bytes that hold the next n bits from the streamFile, never more than this iteration needs
+	 */
+	byteCount = (state->tp.n + BITS_N_BYTE - 1) / BITS_N_BYTE;
+	clearerr(state->streamFile);
+	for (have = 0; have < byteCount; have += got) {
+		got = (long int) fread(bytes + have, sizeof(BYTE), (size_t) (byteCount - have), state->streamFile);
+		if (ferror(state->streamFile)) {
+			errp(226, __func__, "read error while reading file: %s", state->randomDataPath);
+		} else if (got <= 0) {
+			err(226, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+			    state->randomDataPath, have * BITS_N_BYTE);
+		}
+	}
+
+	/*
+	 * Put the bytes read in word order
+	 */
+	num_1s = packBytes(state->packedEpsilon[thread_state->thread_id], bytes, state->tp.n);
+	num_0s = state->tp.n - num_1s;
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	if (state->legacy_output == true) {
+		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", state->tp.n, num_0s, num_1s);
+		if (io_ret <= 0) {
+			errp(226, __func__, "error in writing to %s", state->freqFilePath);
+		}
+		io_ret = fflush(state->freqFile);
+		if (io_ret != 0) {
+			errp(226, __func__, "error flushing to %s", state->freqFilePath);
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * parseBitsMappedInput - copy bits from the memory mapped randdata into the packed bit stream
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * Given the read-only memory map of state->randomDataPath, convert the bytes of the iteration
+ * being done by this thread into bits of the packed bit stream of this thread.
+ *
+ * Unlike parseBitsBinaryInput(), this function does not use the shared streamFile and does not
+ * need to be called while holding the mutex.
+ */
+static void
+parseBitsMappedInput(struct thread_state *thread_state)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	long int bitsRead;	// Number of bits to read and process
+	size_t offset;		// Offset of the first byte of this iteration in the map
+	size_t byteCount;	// Number of bytes that hold the bits of this iteration
+	long int used;		// Number of ASCII characters consumed by decodeASCIIBits()
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(230, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(230, __func__, "state arg is NULL");
+	}
+	if (state->mappedData == NULL) {
+		err(230, __func__, "mappedData is NULL");
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(230, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+
+	/*
+	 * ASCII randdata holds one bit per character: decode it directly from the map
+	 */
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		offset = (size_t) state->base_seek + (size_t) thread_state->iteration_being_done * state->tp.n;
+		num_1s = 0;
+		bitsRead = 0;
+		if (offset < state->mappedLength) {
+			bitsRead = decodeASCIIBits(state->mappedData + offset, (long int) (state->mappedLength - offset),
+						   state->packedEpsilon[thread_state->thread_id], 0, state->tp.n, &used,
+						   &num_1s);
+		}
+		if (bitsRead < state->tp.n) {
+			if (offset < state->mappedLength && offset + (size_t) used < state->mappedLength) {
+				err(230, __func__, "invalid character 0x%02x in ASCII data of file %s after %ld bits were read",
+				    (unsigned int) state->mappedData[offset + (size_t) used], state->randomDataPath, bitsRead);
+			}
+			err(230, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+			    state->randomDataPath, bitsRead);
+		}
+		num_0s = bitsRead - num_1s;
+		reportBitsRead(thread_state, bitsRead, num_0s, num_1s);
+		return;
+	}
+
+	/*
+	 * Locate the bytes of the iteration being done by this thread
+	 */
+	offset = (size_t) state->base_seek + (size_t) thread_state->iteration_being_done * state->tp.n / BITS_N_BYTE;
+	byteCount = ((size_t) state->tp.n + BITS_N_BYTE - 1) / BITS_N_BYTE;
+	if (offset > state->mappedLength || byteCount > state->mappedLength - offset) {
+		err(230, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+		    state->randomDataPath, (long int) (offset < state->mappedLength ?
+						       (state->mappedLength - offset) * BITS_N_BYTE : 0));
+	}
+
+	/*
+	 * Pack the next n bits from the map
+	 */
+	num_1s = packBytes(state->packedEpsilon[thread_state->thread_id], state->mappedData + offset, state->tp.n);
+	num_0s = state->tp.n - num_1s;
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	reportBitsRead(thread_state, state->tp.n, num_0s, num_1s);
+
+	return;
+}
+
+
+/*
+ * parseBitsPositionalInput - pread() bits from randdata into the packed bit stream
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * Read the bytes of the iteration being done by this thread through its private file descriptor,
+ * at the offset of that iteration, straight into the packed bit stream of this thread and put them in word order.
+ *
+ * Like parseBitsMappedInput(), this function does not need to be called while holding the mutex.
+ */
+static void
+parseBitsPositionalInput(struct thread_state *thread_state)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	BYTE *bytes;		// Bytes of the packed bit stream of this thread, in file order until packed
+	off_t offset;		// Offset of the first byte of this iteration in randdata
+	size_t byteCount;	// Number of bytes that hold the bits of this iteration
+	size_t have;		// Number of bytes read so far
+	ssize_t io_ret;		// pread() return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(233, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (thread_state->inputFd < 0) {
+		err(233, __func__, "thread %ld has no open input file descriptor", thread_state->thread_id);
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(233, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+
+	/*
+	 * ASCII randdata holds one bit per character: decode it a block of characters at a time
+	 */
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		parseASCIIPositionalInput(thread_state);
+		return;
+	}
+	bytes = (BYTE *) state->packedEpsilon[thread_state->thread_id];
+
+	/*
+	 * Read all of the bytes of the iteration being done by this thread
+	 */
+	offset = (off_t) state->base_seek + (off_t) thread_state->iteration_being_done * state->tp.n / BITS_N_BYTE;
+	byteCount = ((size_t) state->tp.n + BITS_N_BYTE - 1) / BITS_N_BYTE;
+	for (have = 0; have < byteCount; have += (size_t) io_ret) {
+		errno = 0;	// paranoia
+		io_ret = pread(thread_state->inputFd, bytes + have, byteCount - have, offset + (off_t) have);
+		if (io_ret < 0) {
+			if (errno == EINTR) {
+				io_ret = 0;
+				continue;
+			}
+			errp(233, __func__, "read error while reading file: %s", state->randomDataPath);
+		} else if (io_ret == 0) {
+			err(233, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+			    state->randomDataPath, (long int) have * BITS_N_BYTE);
+		}
+	}
+
+	/*
+	 * Put the bytes read in word order
+	 */
+	num_1s = packBytes(state->packedEpsilon[thread_state->thread_id], bytes, state->tp.n);
+	num_0s = state->tp.n - num_1s;
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	reportBitsRead(thread_state, state->tp.n, num_0s, num_1s);
+
+	return;
+}
+
+
+/*
+ * parseASCIIPositionalInput - pread() ASCII '0'/'1' characters from randdata into the packed bit stream
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * Characters are read through the private file descriptor of this thread into its input buffer,
+ * never more than the number of bits still needed, and decoded into the packed bit stream of this thread.
+ *
+ * Like parseBitsPositionalInput(), this function does not need to be called while holding the mutex.
+ */
+static void
+parseASCIIPositionalInput(struct thread_state *thread_state)
+{
+	long int num_1s;	// Count of 1 bits processed
+	long int bitsRead;	// Number of bits read and processed
+	long int used;		// Number of characters consumed by decodeASCIIBits()
+	off_t offset;		// Offset of the next character to read from randdata
+	size_t want;		// Number of characters to read into the input buffer
+	ssize_t io_ret;		// pread() return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(233, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (state->packedEpsilon[thread_state->thread_id] == NULL) {
+		err(233, __func__, "state->packedEpsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	if (thread_state->inputBuf == NULL) {
+		err(233, __func__, "thread %ld has no input buffer", thread_state->thread_id);
+	}
+
+	/*
+	 * Read and decode until we have all the bits of the iteration being done by this thread
+	 */
+	offset = (off_t) state->base_seek + (off_t) thread_state->iteration_being_done * state->tp.n;
+	num_1s = 0;
+	bitsRead = 0;
+	while (bitsRead < state->tp.n) {
+		want = (size_t) MIN(state->tp.n - bitsRead, ASCII_READ_CHUNK);
+		errno = 0;	// paranoia
+		io_ret = pread(thread_state->inputFd, thread_state->inputBuf, want, offset);
+		if (io_ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			errp(233, __func__, "read error while reading file: %s", state->randomDataPath);
+		} else if (io_ret == 0) {
+			err(233, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+			    state->randomDataPath, bitsRead);
+		}
+		offset += io_ret;
+		bitsRead += decodeASCIIBits(thread_state->inputBuf, (long int) io_ret,
+					    state->packedEpsilon[thread_state->thread_id], bitsRead, state->tp.n - bitsRead,
+					    &used, &num_1s);
+		if (used < (long int) io_ret) {
+			err(233, __func__, "invalid character 0x%02x in ASCII data of file %s after %ld bits were read",
+			    (unsigned int) thread_state->inputBuf[used], state->randomDataPath, bitsRead);
+		}
+	}
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	reportBitsRead(thread_state, bitsRead, bitsRead - num_1s, num_1s);
+
+	return;
+}
+
+/*
+ * reportBitsRead - write the bit counts of an iteration to freq.txt if in legacy_output mode
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      bitsRead        // number of bits read for this iteration
+ *      num_0s          // number of 0 bits read for this iteration
+ *      num_1s          // number of 1 bits read for this iteration
+ *
+ * This function is used by readers that do not hold the mutex while reading,
+ * so it takes the mutex while writing to the shared freq.txt stream.
+ */
+static void
+reportBitsRead(struct thread_state *thread_state, long int bitsRead, long int num_0s, long int num_1s)
+{
+	int io_ret;		// I/O return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(230, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(230, __func__, "state arg is NULL");
+	}
+	if (state->legacy_output == false) {
+		return;
+	}
+
+	pthread_mutex_lock(thread_state->mutex);
+	io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
+	if (io_ret <= 0) {
+		errp(230, __func__, "error in writing to %s", state->freqFilePath);
+	}
+	io_ret = fflush(state->freqFile);
+	if (io_ret != 0) {
+		errp(230, __func__, "error flushing to %s", state->freqFilePath);
+	}
+	pthread_mutex_unlock(thread_state->mutex);
+
+	return;
+}
+
+
+/*
+ * openPositionalInput - open a private file descriptor on randdata for a thread
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * Each thread that reads with pread() owns its own file descriptor and its own
+ * buffer holding the bytes of one iteration.
+ *
+ * This function does not return on error.
+ */
+static void
+openPositionalInput(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(234, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(234, __func__, "state arg is NULL");
+	}
+	if (state->stdinData == true) {
+		err(234, __func__, "cannot pread() from standard input");
+	}
+
+	/*
+	 * Open randdata for this thread
+	 */
+	errno = 0;		// paranoia
+	thread_state->inputFd = open(state->randomDataPath, O_RDONLY);
+	if (thread_state->inputFd < 0) {
+		errp(234, __func__, "thread %ld unable to open data file to reading: %s", thread_state->thread_id,
+		     state->randomDataPath);
+	}
+	(void) posix_fadvise(thread_state->inputFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	/*
+	 * Allocate the buffer for the ASCII characters of one pread()
+	 *
+	 * Raw binary randdata is read directly into the packed bit stream and needs no separate buffer.
+	 */
+	if (state->dataFormat != FORMAT_ASCII_01) {
+		dbg(DBG_HIGH, "Thread %ld opened fd %d for positional reads", thread_state->thread_id, thread_state->inputFd);
+		return;
+	}
+	thread_state->inputBuf = malloc((size_t) MIN(state->tp.n, ASCII_READ_CHUNK));
+	if (thread_state->inputBuf == NULL) {
+		errp(234, __func__, "cannot malloc input buffer of %ld bytes for thread %ld",
+		     (long int) MIN(state->tp.n, ASCII_READ_CHUNK), thread_state->thread_id);
+	}
+	dbg(DBG_HIGH, "Thread %ld opened fd %d for positional reads", thread_state->thread_id, thread_state->inputFd);
+
+	return;
+}
+
+
+/*
+ * closePositionalInput - close the private file descriptor of a thread and free its buffer
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * This function does not return on error.
+ */
+static void
+closePositionalInput(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(234, __func__, "thread_state arg is NULL");
+	}
+
+	if (thread_state->inputFd >= 0) {
+		errno = 0;	// paranoia
+		if (close(thread_state->inputFd) != 0) {
+			errp(234, __func__, "error closing fd of thread %ld", thread_state->thread_id);
+		}
+		thread_state->inputFd = -1;
+	}
+	if (thread_state->inputBuf != NULL) {
+		free(thread_state->inputBuf);
+		thread_state->inputBuf = NULL;
+	}
+
+	return;
+}
+
+
+/*
+ * mapInputFile - memory map the open randdata file for reading by all threads
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * Map the whole of the regular file open on state->streamFile read-only into memory.
+ * The kernel is told that each thread reads its slice sequentially.
+ *
+ * This function does not return on error.
+ */
+static void
+mapInputFile(struct state *state)
+{
+	struct stat buf;	// randdata file status
+	void *map;		// mmap() return value
+	int fd;			// file descriptor of the open streamFile
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(231, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(231, __func__, "streamFile is NULL");
+	}
+	if (state->stdinData == true) {
+		err(231, __func__, "cannot memory map standard input");
+	}
+
+	/*
+	 * Determine the size of the input file
+	 */
+	fd = fileno(state->streamFile);
+	if (fd < 0) {
+		errp(231, __func__, "cannot obtain file descriptor for: %s", state->randomDataPath);
+	}
+	errno = 0;		// paranoia
+	if (fstat(fd, &buf) < 0) {
+		errp(231, __func__, "cannot fstat: %s", state->randomDataPath);
+	}
+	if (!S_ISREG(buf.st_mode)) {
+		err(231, __func__, "-R m requires randdata to be a regular file: %s", state->randomDataPath);
+	}
+	if (buf.st_size <= 0) {
+		err(231, __func__, "encounted EOF (end of file) while reading file: %s: 0 bits were read before EOF",
+		    state->randomDataPath);
+	}
+
+	/*
+	 * Map the entire file read-only
+	 */
+	errno = 0;		// paranoia
+	map = mmap(NULL, (size_t) buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		errp(231, __func__, "cannot mmap %lld bytes of: %s", (long long) buf.st_size, state->randomDataPath);
+	}
+	(void) posix_madvise(map, (size_t) buf.st_size, POSIX_MADV_SEQUENTIAL);
+	state->mappedData = (BYTE *) map;
+	state->mappedLength = (size_t) buf.st_size;
+	dbg(DBG_MED, "mapped %lld bytes of %s", (long long) buf.st_size, state->randomDataPath);
+
+	return;
+}
+
+
+/*
+ * unmapInputFile - undo the memory map of randdata
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * This function does not return on error.
+ */
+static void
+unmapInputFile(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(231, __func__, "state arg is NULL");
+	}
+	if (state->mappedData == NULL) {
+		return;
+	}
+
+	errno = 0;		// paranoia
+	if (munmap(state->mappedData, state->mappedLength) != 0) {
+		errp(231, __func__, "cannot munmap: %s", state->randomDataPath);
+	}
+	state->mappedData = NULL;
+	state->mappedLength = 0;
+
+	return;
+}
+
+
+/*
+ * packBytes - pack the bits of binary bytes into a packed bit stream
+ *
+ * given:
+ *      dst             // packed bit stream of at least PACKED_WORDS(bitCount) words
+ *      src             // bytes holding the bits, most significant bit first, may be the bytes of dst
+ *      bitCount        // number of bits to pack
+ *
+ * returns:
+ *      number of 1 bits among the bitCount bits
+ *
+ * A byte of raw binary randdata already holds 8 bits in the order of a packed bit stream, so each
+ * word is simply 8 bytes read most significant byte first.  src may be dst itself: raw binary is then
+ * read straight into the bytes of the packed bit stream and put in word order in place.  The bits of the last
+ * word after bit bitCount - 1 are zeroed.  The zero word that follows the last packed bit is never written.
+ */
+static long int
+packBytes(WORD64 *dst, BYTE const *src, long int bitCount)
+{
+	BYTE bytes[sizeof(WORD64)];	// Bytes of the word being packed, in src order
+	WORD64 word;			// Word being packed
+	long int wordCount;		// Number of words holding all of the bits
+	long int byteCount;		// Number of bytes of src in the word being packed
+	long int ones;			// Number of 1 bits packed
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (dst == NULL) {
+		err(235, __func__, "dst arg is NULL");
+	}
+	if (src == NULL) {
+		err(235, __func__, "src arg is NULL");
+	}
+
+	ones = 0;
+	wordCount = (bitCount + BITS_N_WORD64 - 1) / BITS_N_WORD64;
+	for (i = 0; i < wordCount; i++) {
+
+		/*
+		 * Take the next 8 bytes, or those left of a final partial word followed by zeros
+		 */
+		byteCount = (bitCount - i * BITS_N_WORD64 + BITS_N_BYTE - 1) / BITS_N_BYTE;
+		if (byteCount >= (long int) sizeof(word)) {
+			memcpy(&word, src + i * (long int) sizeof(word), sizeof(word));
+		} else {
+			memset(bytes, 0, sizeof(bytes));
+			memcpy(bytes, src + i * (long int) sizeof(word), (size_t) byteCount);
+			memcpy(&word, bytes, sizeof(word));
+		}
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+		word = __builtin_bswap64(word);
+#endif
+
+		/*
+		 * Drop any bits past the last one of a final partial word
+		 */
+		if (bitCount - i * BITS_N_WORD64 < BITS_N_WORD64) {
+			word &= ~(WORD64) 0 << (BITS_N_WORD64 - (bitCount - i * BITS_N_WORD64));
+		}
+		ones += __builtin_popcountll(word);
+		dst[i] = word;
+	}
+
+	return ones;
+}
+
+
+/*
+ * packedPopcount - count the 1 bits in a range of a packed bit stream
+ *
+ * given:
+ *      packed          // packed bit stream
+ *      first           // first bit of the range
+ *      count           // number of bits in the range
+ *
+ * returns:
+ *      number of 1 bits in bits first thru first + count - 1
+ */
+long int
+packedPopcount(const WORD64 *packed, long int first, long int count)
+{
+	long int ones;		// Number of 1 bits found so far
+	long int w;		// Index of the next whole word in the range
+	long int head;		// Number of bits before the first whole word in the range
+
+	if (count <= 0) {
+		return 0;
+	}
+
+	/*
+	 * Count the bits before the first whole word
+	 */
+	ones = 0;
+	head = (BITS_N_WORD64 - first % BITS_N_WORD64) % BITS_N_WORD64;
+	if (head > count) {
+		head = count;
+	}
+	if (head > 0) {
+		ones += __builtin_popcountll(packedWindow(packed, first, (int) head));
+		first += head;
+		count -= head;
+	}
+
+	/*
+	 * Count whole words, then the bits after the last whole word
+	 */
+	for (w = first / BITS_N_WORD64; count >= BITS_N_WORD64; w++, count -= BITS_N_WORD64) {
+		ones += __builtin_popcountll(packed[w]);
+	}
+	if (count > 0) {
+		ones += __builtin_popcountll(packed[w] >> (BITS_N_WORD64 - count));
+	}
+	return ones;
+}
+
+/*
+ * packedTransitions - count the bits of a packed bit stream that differ from the bit before them
+ *
+ * given:
+ *      packed          // packed bit stream
+ *      count           // number of bits, starting with bit 0, to consider
+ *
+ * returns:
+ *      number of k, 1 <= k < count, where bit k != bit k - 1
+ *
+ * Each word is compared with itself shifted by one bit, with the last bit of the
+ * previous word carried into the most significant end.
+ */
+long int
+packedTransitions(const WORD64 *packed, long int count)
+{
+	long int transitions;	// Number of transitions found so far
+	long int wordCount;	// Number of words holding the count bits
+	long int tail;		// Number of bits used in the last word
+	WORD64 carry;		// Last bit of the previous word in the most significant bit
+	WORD64 diff;		// Bits that differ from the bit before them
+	long int w;
+
+	if (count <= 1) {
+		return 0;
+	}
+	wordCount = (count + BITS_N_WORD64 - 1) / BITS_N_WORD64;
+
+	/*
+	 * Bit 0 has no bit before it, so carry a copy of it into the first word
+	 */
+	transitions = 0;
+	carry = packed[0] & ((WORD64) 1 << (BITS_N_WORD64 - 1));
+	for (w = 0; w < wordCount - 1; w++) {
+		diff = packed[w] ^ ((packed[w] >> 1) | carry);
+		transitions += __builtin_popcountll(diff);
+		carry = packed[w] << (BITS_N_WORD64 - 1);
+	}
+
+	/*
+	 * Ignore bits past count in the last word
+	 */
+	diff = packed[w] ^ ((packed[w] >> 1) | carry);
+	tail = count - w * BITS_N_WORD64;
+	if (tail < BITS_N_WORD64) {
+		diff &= ~(~(WORD64) 0 >> tail);
+	}
+	transitions += __builtin_popcountll(diff);
+
+	return transitions;
+}
+
+/*
+ * walkSteps - the effect of the 8 bits of each byte value on a -1/+1 random walk
+ *
+ * For the bits of a byte, most significant bit first, walkSteps[byte] holds the sum of their -1/+1 values
+ * and the maximum and minimum of the partial sums after each of them.  Filled in once by makeWalkSteps().
+ */
+static struct {
+	signed char net;	// Sum of the 8 -1/+1 values
+	signed char max;	// Maximum of the 8 partial sums
+	signed char min;	// Minimum of the 8 partial sums
+} walkSteps[256];
+static pthread_once_t walkStepsOnce = PTHREAD_ONCE_INIT;	// Ensures walkSteps[] is filled in just once
+
+
+/*
+ * makeWalkSteps - fill in walkSteps[]
+ */
+static void
+makeWalkSteps(void)
+{
+	int S;			// Partial sum
+	int S_max;		// Maximum partial sum
+	int S_min;		// Minimum partial sum
+	int byte;
+	int i;
+
+	for (byte = 0; byte < 256; byte++) {
+		S = 0;
+		S_max = -BITS_N_BYTE;
+		S_min = BITS_N_BYTE;
+		for (i = BITS_N_BYTE - 1; i >= 0; i--) {
+			S += ((byte >> i) & 1) ? 1 : -1;
+			S_max = MAX(S, S_max);
+			S_min = MIN(S, S_min);
+		}
+		walkSteps[byte].net = (signed char) S;
+		walkSteps[byte].max = (signed char) S_max;
+		walkSteps[byte].min = (signed char) S_min;
+	}
+}
+
+
+/*
+ * WALK_CYCLE_STATES - number of states x, from -MAX_EXCURSION_RND_EXCURSION_VAR thru MAX_EXCURSION_RND_EXCURSION_VAR,
+ * whose visits are counted during a cycle of a random walk (see endWalkCycle())
+ */
+#define WALK_CYCLE_STATES (2 * MAX_EXCURSION_RND_EXCURSION_VAR + 1)
+
+
+/*
+ * endWalkCycle - add the state visits of a cycle of a random walk that has just ended
+ *
+ * given:
+ *      walk            // random walk being computed
+ *      cycle           // cycle[x + MAX_EXCURSION_RND_EXCURSION_VAR]: visits to state x in the cycle, zeroed on return
+ */
+static void
+endWalkCycle(struct walk *walk, long int *cycle)
+{
+	long int x;		// State value
+	long int i;		// Index of state x
+
+	for (x = -MAX_EXCURSION_RND_EXCURSION_VAR; x <= MAX_EXCURSION_RND_EXCURSION_VAR; x++) {
+		if (x != 0) {
+			i = x + ((x < 0) ? MAX_EXCURSION_RND_EXCURSION_VAR : MAX_EXCURSION_RND_EXCURSION_VAR - 1);
+			walk->visits[i] += cycle[x + MAX_EXCURSION_RND_EXCURSION_VAR];
+		}
+	}
+	for (x = -MAX_EXCURSION_RND_EXCURSION; x <= MAX_EXCURSION_RND_EXCURSION; x++) {
+		if (x != 0) {
+			i = x + ((x < 0) ? MAX_EXCURSION_RND_EXCURSION : MAX_EXCURSION_RND_EXCURSION - 1);
+			walk->lastCycle[i] = cycle[x + MAX_EXCURSION_RND_EXCURSION_VAR];
+			walk->cycles[MIN(walk->lastCycle[i], DEGREES_OF_FREEDOM_RND_EXCURSION - 1)][i]++;
+		}
+	}
+	memset(cycle, 0, WALK_CYCLE_STATES * sizeof(cycle[0]));
+}
+
+
+/*
+ * getWalk - return the -1/+1 random walk of the current iteration of a thread
+ *
+ * given:
+ *      state           // pointer to run state
+ *      thread_id       // thread whose state->packedEpsilon[thread_id] forms the walk
+ *
+ * returns:
+ *      pointer to state->walk[thread_id], computed from the current iteration
+ *
+ * The walk is computed by the first test that asks for it in an iteration and then shared
+ * by all other tests of that thread until the next iteration is loaded.  The walk takes the bits
+ * a byte at a time from state->packedEpsilon[thread_id], using walkSteps[] for the extrema within
+ * each byte.  When state->walkVisitsNeeded is true, the visits to the excursion states are counted
+ * in a single pass, cycle by cycle, so the partial sums themselves are never stored.  Bytes are
+ * then only taken one bit at a time while the walk is close enough to 0 to visit an excursion state.
+ *
+ * This function does not return on error.
+ */
+struct walk *
+getWalk(struct state *state, long int thread_id)
+{
+	struct walk *walk;		// Random walk of the thread
+	WORD64 const *packed;		// Packed bit stream of the thread
+	long int cycle[WALK_CYCLE_STATES];	// cycle[x + MAX_EXCURSION_RND_EXCURSION_VAR]: visits to state x in this cycle
+	bool visits;			// true ==> count the visits to the excursion states
+	unsigned int byte;		// Byte of the packed bit stream starting at bit k
+	long int S;			// Partial sum
+	long int S_max;			// Maximum partial sum
+	long int S_min;			// Minimum partial sum
+	long int n;			// Length of a single bit stream
+	long int k;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(236, __func__, "state arg is NULL");
+	}
+	if (state->walk == NULL) {
+		err(236, __func__, "state->walk is NULL");
+	}
+	walk = &state->walk[thread_id];
+	if (walk->valid == true) {
+		return walk;
+	}
+	if (state->packedEpsilon == NULL || state->packedEpsilon[thread_id] == NULL) {
+		err(236, __func__, "state->packedEpsilon[%ld] is NULL", thread_id);
+	}
+	packed = state->packedEpsilon[thread_id];
+	n = state->tp.n;
+	pthread_once(&walkStepsOnce, makeWalkSteps);
+
+	/*
+	 * Walk the bits, counting the visits to the excursion states if needed
+	 */
+	visits = state->walkVisitsNeeded;
+	walk->zeros = 0;
+	memset(walk->visits, 0, sizeof(walk->visits));
+	memset(walk->cycles, 0, sizeof(walk->cycles));
+	memset(walk->lastCycle, 0, sizeof(walk->lastCycle));
+	memset(cycle, 0, sizeof(cycle));
+	S = 0;
+	S_max = 0;
+	S_min = 0;
+	for (k = 0; k < n;) {
+
+		/*
+		 * Take a whole byte if no partial sum within it can be an excursion state or 0
+		 */
+		if (k % BITS_N_BYTE == 0 && k + BITS_N_BYTE <= n &&
+		    (visits == false || labs(S) > MAX_EXCURSION_RND_EXCURSION_VAR + BITS_N_BYTE)) {
+			byte = (unsigned int) (packed[k / BITS_N_WORD64]
+					       >> (BITS_N_WORD64 - BITS_N_BYTE - k % BITS_N_WORD64)) & 0xff;
+			S_max = MAX(S + walkSteps[byte].max, S_max);
+			S_min = MIN(S + walkSteps[byte].min, S_min);
+			S += walkSteps[byte].net;
+			k += BITS_N_BYTE;
+			continue;
+		}
+
+		/*
+		 * Otherwise take a single bit, counting the state it visits
+		 */
+		S += (packedBit(packed, k) != 0) ? 1 : -1;
+		S_max = MAX(S, S_max);
+		S_min = MIN(S, S_min);
+		if (visits == true && labs(S) <= MAX_EXCURSION_RND_EXCURSION_VAR) {
+			if (S == 0) {
+				walk->zeros++;
+				endWalkCycle(walk, cycle);
+			} else {
+				cycle[S + MAX_EXCURSION_RND_EXCURSION_VAR]++;
+			}
+		}
+		k++;
+	}
+
+	/*
+	 * The last cycle ends with the walk if it does not end at 0
+	 */
+	if (visits == true && S != 0) {
+		endWalkCycle(walk, cycle);
+	}
+	walk->final = S;
+	walk->max = S_max;
+	walk->min = S_min;
+	walk->valid = true;
+
+	return walk;
+}
+
+
+/*
+ * getPatternCounts - count the overlapping patterns of a given width in the current iteration of a thread
+ *
+ * given:
+ *      state           // pointer to run state
+ *      thread_id       // thread whose state->packedEpsilon[thread_id] holds the bits
+ *      width           // width of the patterns to count, 0 thru state->patternWidth
+ *      count           // array of (1 << width) counters
+ *
+ * Sets count[x] to the number of the n overlapping windows of width bits equal to x, where the windows
+ * at the end of the sequence wrap around to its start.  The first bit of a window is its most significant bit.
+ *
+ * The patterns of width state->patternWidth are counted in a single pass over the bits by the first
+ * call of an iteration, and then shared by all other calls of that thread until the next iteration is loaded.
+ * A window of width bits is the prefix of the window of state->patternWidth bits that starts at the same
+ * bit, so narrower patterns are counted by adding up the counts of the wider patterns they prefix.
+ *
+ * This function does not return on error.
+ */
+void
+getPatternCounts(struct state *state, long int thread_id, long int width, long int *count)
+{
+	struct patterns *patterns;	// Patterns of the thread
+	WORD64 const *packed;		// Packed bit stream of the thread
+	long int n;			// Length of a single bit stream
+	long int W;			// Width of the shared patterns
+	long int tail;			// Bits of a wrapped window that come from the end of the sequence
+	long int x;
+	long int p;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(238, __func__, "state arg is NULL");
+	}
+	if (count == NULL) {
+		err(238, __func__, "count arg is NULL");
+	}
+	if (state->patterns == NULL || state->patterns[thread_id].count == NULL) {
+		err(238, __func__, "patterns[%ld] were not allocated", thread_id);
+	}
+	if (width < 0 || width > state->patternWidth) {
+		err(238, __func__, "width: %ld must be in [0, %ld]", width, state->patternWidth);
+	}
+	patterns = &state->patterns[thread_id];
+	n = state->tp.n;
+	W = state->patternWidth;
+
+	/*
+	 * Count the patterns of width W, unless already done for this iteration
+	 */
+	if (patterns->valid == false) {
+		if (state->packedEpsilon == NULL || state->packedEpsilon[thread_id] == NULL) {
+			err(238, __func__, "state->packedEpsilon[%ld] is NULL", thread_id);
+		}
+		if (n < W) {
+			err(238, __func__, "n: %ld must be >= the pattern width: %ld", n, W);
+		}
+		packed = state->packedEpsilon[thread_id];
+		memset(patterns->count, 0, ((size_t) 1 << W) * sizeof(patterns->count[0]));
+		for (p = 0; p + W <= n; p++) {
+			patterns->count[packedWindow(packed, p, (int) W)]++;
+		}
+		for (; p < n; p++) {
+			tail = n - p;
+			patterns->count[(packedWindow(packed, p, (int) tail) << (W - tail)) |
+					packedWindow(packed, 0, (int) (W - tail))]++;
+		}
+		patterns->valid = true;
+	}
+
+	/*
+	 * Add up the counts of the patterns of width W with the same first width bits
+	 */
+	if (width == W) {
+		memcpy(count, patterns->count, ((size_t) 1 << W) * sizeof(count[0]));
+	} else {
+		memset(count, 0, ((size_t) 1 << width) * sizeof(count[0]));
+		for (x = 0; x < ((long int) 1 << W); x++) {
+			count[x >> (W - width)] += patterns->count[x];
+		}
+	}
+}
+
+
+/*
+ * reserveScratch - reserve room in the scratch arena of each test thread
+ *
+ * given:
+ *      state           // run state
+ *      size            // bytes that an iterate function will take with scratchAlloc() for each iteration
+ *
+ * Called by the init function of a test, before init() allocates the arenas with createScratch().
+ * Each reservation is rounded up to SCRATCH_ALIGN bytes, as scratchAlloc() rounds each chunk it hands out.
+ * The reservations of one test add up, while the arena is shared by the tests one after the other.
+ */
+void
+reserveScratch(struct state *state, size_t size)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(244, __func__, "state arg is NULL");
+	}
+	if (state->scratch != NULL) {
+		err(244, __func__, "scratch arenas were already allocated");
+	}
+
+	state->scratchSize += (size + SCRATCH_ALIGN - 1) / SCRATCH_ALIGN * SCRATCH_ALIGN;
+	return;
+}
+
+
+/*
+ * createScratch - allocate the scratch arena of each test thread
+ *
+ * given:
+ *      state           // run state
+ *
+ * Each arena holds state->scratchSize bytes, the largest reservation made by the init function of an
+ * enabled test, starting on a SCRATCH_ALIGN byte boundary.
+ */
+void
+createScratch(struct state *state)
+{
+	int io_ret;		// posix_memalign() return status
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(245, __func__, "state arg is NULL");
+	}
+
+	state->scratch = calloc((size_t) state->numberOfThreads, sizeof(*state->scratch));
+	if (state->scratch == NULL) {
+		errp(245, __func__, "cannot calloc for scratch: %ld elements of %lu bytes each",
+		     state->numberOfThreads, sizeof(*state->scratch));
+	}
+	for (i = 0; state->scratchSize > 0 && i < state->numberOfThreads; i++) {
+		io_ret = posix_memalign((void **) &state->scratch[i].base, SCRATCH_ALIGN, state->scratchSize);
+		if (io_ret != 0) {
+			errno = io_ret;
+			errp(245, __func__, "cannot posix_memalign %lu bytes for scratch[%ld].base", state->scratchSize, i);
+		}
+	}
+	dbg(DBG_MED, "each test thread has a scratch arena of %lu bytes", state->scratchSize);
+	return;
+}
+
+
+/*
+ * scratchAlloc - take storage for the current test from the scratch arena of a test thread
+ *
+ * given:
+ *      thread_state    // pointer to the state of the thread running the iteration
+ *      size            // bytes to take
+ *
+ * returns:
+ *      SCRATCH_ALIGN aligned storage of size bytes, valid until the thread starts its next test
+ *
+ * The storage is not zeroized.  An iterate function may only take what its init function reserved
+ * with reserveScratch().
+ *
+ * This function does not return on error.
+ */
+void *
+scratchAlloc(struct thread_state *thread_state, size_t size)
+{
+	struct scratch_arena *arena;	// Scratch arena of the thread
+	void *chunk;			// Storage taken from the arena
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(246, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(246, __func__, "state arg is NULL");
+	}
+	if (state->scratch == NULL) {
+		err(246, __func__, "state->scratch is NULL");
+	}
+	arena = &state->scratch[thread_state->thread_id];
+	size = (size + SCRATCH_ALIGN - 1) / SCRATCH_ALIGN * SCRATCH_ALIGN;
+	if (arena->base == NULL || size > state->scratchSize - arena->used) {
+		err(246, __func__, "scratch arena of thread %ld cannot hold %lu more bytes: %lu of %lu bytes used",
+		    thread_state->thread_id, size, arena->used, state->scratchSize);
+	}
+
+	chunk = arena->base + arena->used;
+	arena->used += size;
+	return chunk;
+}
+
+
+/*
+ * runBlocks - work on the independent blocks of an iteration, split into up to state->blockThreads shares
+ *
+ * given:
+ *      thread_state    // pointer to the state of the test thread running the iteration
+ *      blockCount      // number of independent blocks in the iteration
+ *      work            // function that works on the blocks of one share
+ *      results         // array of state->blockThreads counters, one for each share
+ *      resultSize      // size in bytes of each counter of results
+ *
+ * The blocks are split into shares of consecutive blocks, state->blockThreads of them unless there are
+ * fewer blocks than that.  The calling thread publishes all but the first share on its task graph, where
+ * the idle test threads take them (see nextTask()), and works on the first share.  It then works on the
+ * published shares that no thread has taken yet, and waits for those taken by other threads.  All of the
+ * counters of results are zeroized before any work is done, so once every share is done the caller may
+ * simply add up the state->blockThreads counters.
+ *
+ * When state->blockThreads is 1, work is simply called on all of the blocks by the calling thread.
+ *
+ * This function does not return on error.
+ */
+void
+runBlocks(struct thread_state *thread_state, long int blockCount, void (*work)(struct block_range *range),
+	  void *results, size_t resultSize)
+{
+	struct block_shares *blocks;	// Shares of the calling thread, or NULL
+	struct block_range single;	// The only share when the blocks are not split
+	struct block_range *range;	// Shares of the blocks
+	struct task_graph *graph;	// Graph on which the shares are published
+	long int shares;		// Number of shares
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(237, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(237, __func__, "state arg is NULL");
+	}
+	if (work == NULL) {
+		err(237, __func__, "work arg is NULL");
+	}
+	if (results == NULL) {
+		err(237, __func__, "results arg is NULL");
+	}
+	if (state->blockThreads < 1) {
+		err(237, __func__, "state->blockThreads: %ld must be >= 1", state->blockThreads);
+	}
+	blocks = thread_state->blocks;
+	graph = thread_state->graph;
+	if (state->blockThreads > 1 && (blocks == NULL || graph == NULL)) {
+		err(237, __func__, "thread %ld has no block shares or no task graph for its %ld shares",
+		    thread_state->thread_id, state->blockThreads);
+	}
+
+	/*
+	 * Split the blocks into shares
+	 */
+	memset(results, 0, (size_t) state->blockThreads * resultSize);
+	shares = MAX(1, MIN(state->blockThreads, blockCount));
+	range = (blocks == NULL ? &single : blocks->range);
+	for (i = 0; i < shares; i++) {
+		range[i].thread_state = thread_state;
+		range[i].worker = i;
+		range[i].slot = thread_state->thread_id * state->blockThreads + i;
+		range[i].first = blockCount * i / shares;
+		range[i].count = blockCount * (i + 1) / shares - range[i].first;
+		range[i].result = (char *) results + i * resultSize;
+		range[i].work = work;
+	}
+	if (shares == 1) {
+		work(&range[0]);
+		return;
+	}
+
+	/*
+	 * Publish all but the first share for the idle test threads, and work on the first share
+	 */
+	pthread_mutex_lock(&graph->lock);
+	for (i = shares - 1; i > 0; i--) {
+		graph->share[graph->shareCount++] = &range[i];
+	}
+	blocks->pending = shares - 1;
+	pthread_cond_broadcast(&graph->wake);
+	pthread_mutex_unlock(&graph->lock);
+
+	work(&range[0]);
+
+	/*
+	 * Work on the shares that are still published, then wait for those taken by other threads
+	 *
+	 * NOTE: The shares left may belong to another thread, as every share on the stack
+	 *	 has to be done anyway and none of them waits on anything.
+	 */
+	pthread_mutex_lock(&graph->lock);
+	while (blocks->pending > 0) {
+		if (graph->shareCount > 0) {
+			runShare(thread_state, graph);
+		} else {
+			pthread_cond_wait(&blocks->done, &graph->lock);
+		}
+	}
+	pthread_mutex_unlock(&graph->lock);
+}
+
+
+/*
+ * runShare - work on the block share at the top of the stack of a task graph
+ *
+ * given:
+ *      thread_state    // pointer to the state of the test thread doing the work
+ *      graph           // task graph with at least one published share, whose lock is held
+ *
+ * The lock of the graph is released while working on the share, and held again on return.
+ * The thread that published the share is signaled when the last of its shares is done.
+ */
+static void
+runShare(struct thread_state *thread_state, struct task_graph *graph)
+{
+	struct block_range *share;	// Share to work on
+	struct block_shares *blocks;	// Shares of the thread that published share
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(237, __func__, "thread_state arg is NULL");
+	}
+	if (graph == NULL) {
+		err(237, __func__, "graph arg is NULL");
+	}
+	if (graph->shareCount <= 0) {
+		err(237, __func__, "graph has no share to work on");
+	}
+
+	/*
+	 * Work on the share
+	 */
+	share = graph->share[--graph->shareCount];
+	if (share->thread_state != thread_state) {
+		graph->shareSteals++;
+	}
+	pthread_mutex_unlock(&graph->lock);
+	share->work(share);
+	pthread_mutex_lock(&graph->lock);
+
+	/*
+	 * Tell the thread that published the share when all of its shares are done
+	 */
+	blocks = share->thread_state->blocks;
+	blocks->pending--;
+	if (blocks->pending == 0) {
+		pthread_cond_signal(&blocks->done);
+	}
+}
+
+
+/*
+ * createBlockShares - allocate the block shares of the iterations of a test thread
+ *
+ * given:
+ *      thread_state    // pointer to the state of the test thread, before it is created
+ *
+ * This function does not return on error.
+ */
+static void
+createBlockShares(struct thread_state *thread_state)
+{
+	struct block_shares *blocks;	// Shares to setup
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(237, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(237, __func__, "state arg is NULL");
+	}
+	if (state->blockThreads <= 1) {
+		err(237, __func__, "state->blockThreads: %ld must be > 1", state->blockThreads);
+	}
+
+	/*
+	 * Allocate the shares
+	 */
+	blocks = calloc(1, sizeof(*blocks));
+	if (blocks == NULL) {
+		errp(237, __func__, "cannot calloc block shares of %lu bytes", sizeof(*blocks));
+	}
+	blocks->range = calloc((size_t) state->blockThreads, sizeof(*blocks->range));
+	if (blocks->range == NULL) {
+		errp(237, __func__, "cannot calloc for range: %ld elements of %lu bytes each", state->blockThreads,
+		     sizeof(*blocks->range));
+	}
+	if (pthread_cond_init(&blocks->done, NULL) != 0) {
+		errp(237, __func__, "error on pthread_cond_init()");
+	}
+	thread_state->blocks = blocks;
+
+	return;
+}
+
+
+/*
+ * destroyBlockShares - free the block shares of a test thread
+ *
+ * given:
+ *      thread_state    // pointer to the state of the test thread, after it has been joined
+ *
+ * This function does not return on error.
+ */
+static void
+destroyBlockShares(struct thread_state *thread_state)
+{
+	struct block_shares *blocks;	// Shares to free
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(237, __func__, "thread_state arg is NULL");
+	}
+	blocks = thread_state->blocks;
+	if (blocks == NULL) {
+		err(237, __func__, "thread %ld has no block shares", thread_state->thread_id);
+	}
+	if (blocks->pending != 0) {
+		err(237, __func__, "thread %ld still has %ld block shares pending", thread_state->thread_id, blocks->pending);
+	}
+
+	pthread_cond_destroy(&blocks->done);
+	free(blocks->range);
+	free(blocks);
+	thread_state->blocks = NULL;
+
+	return;
 }
 
 
@@ -40,8 +40,6 @@ extern long int str2longint(bool * success_p, char *string);
 extern void generatorOptions(struct state *state);
 extern void chooseTests(struct state *state);
 extern void fixParameters(struct state *state);
-extern bool copyBitsToEpsilon(struct state *state, long int thread_id, BYTE *x, long int xBitLength, long int *num_0s,
-			      long int *num_1s, long int *bitsRead);
 extern void invokeTestSuite(struct state *state);
 extern void read_from_p_val_file(struct state *state);
 extern void write_p_val_to_file(struct state *state);
@@ -50,5 +48,51 @@ extern int sum_will_overflow_long(long int si_a, long int si_b);
 extern int multiplication_will_overflow_long(long int si_a, long int si_b);
 extern void getTimestamp(char *buf, size_t len);
 extern void append_string_to_linked_list(struct Node **head, char* string);
+extern long int packedPopcount(const WORD64 *packed, long int first, long int count);
+extern long int packedTransitions(const WORD64 *packed, long int count);
+extern struct walk *getWalk(struct state *state, long int thread_id);
+extern void getPatternCounts(struct state *state, long int thread_id, long int width, long int *count);
+extern void reserveScratch(struct state *state, size_t size);
+extern void createScratch(struct state *state);
+extern void *scratchAlloc(struct thread_state *thread_state, size_t size);
+extern void runBlocks(struct thread_state *thread_state, long int blockCount, void (*work)(struct block_range *range),
+		      void *results, size_t resultSize);
+
+/*
+ * Packed bit streams
+ *
+ * Bit i of a packed bit stream is bit (BITS_N_WORD64 - 1 - i % BITS_N_WORD64) of word i / BITS_N_WORD64,
+ * so reading a word from its most significant end gives bits in the same order as randdata.
+ * A packed bit stream of n bits is followed by a zero word, so a window may always read one word past it.
+ */
+#   define PACKED_WORDS(n)	(((n) + BITS_N_WORD64 - 1) / BITS_N_WORD64 + 1)	// Words to hold n packed bits
+
+/*
+ * packedBit - bit i of a packed bit stream
+ */
+static inline int
+packedBit(const WORD64 *packed, long int i)
+{
+	return (int) ((packed[i / BITS_N_WORD64] >> (BITS_N_WORD64 - 1 - i % BITS_N_WORD64)) & 1);
+}
+
+/*
+ * packedWindow - the k bits (1 <= k <= BITS_N_WORD64) of a packed bit stream starting at bit i
+ *
+ * Bit i is the most significant of the k returned bits.
+ */
+static inline WORD64
+packedWindow(const WORD64 *packed, long int i, int k)
+{
+	long int w = i / BITS_N_WORD64;		// Word holding bit i
+	int o = (int) (i % BITS_N_WORD64);	// Offset of bit i from the most significant end of that word
+	WORD64 bits;				// Bits from i onward, most significant first
+
+	bits = packed[w] << o;
+	if (o + k > BITS_N_WORD64) {
+		bits |= packed[w + 1] >> (BITS_N_WORD64 - o);
+	}
+	return bits >> (BITS_N_WORD64 - k);
+}
 
 #endif				/* UTILITY_H */
@@ -726,70 +726,100 @@ generator_report_iteration(void)
 }
 
 
+/*
+ * byteToBits - the 8 epsilon bits of each byte value, most significant bit first
+ */
+#define BYTE_BITS(b) { ((b) >> 7) & 1, ((b) >> 6) & 1, ((b) >> 5) & 1, ((b) >> 4) & 1, \
+		       ((b) >> 3) & 1, ((b) >> 2) & 1, ((b) >> 1) & 1, (b) & 1 }
+#define BYTE_BITS_4(b) BYTE_BITS(b), BYTE_BITS((b) + 1), BYTE_BITS((b) + 2), BYTE_BITS((b) + 3)
+#define BYTE_BITS_16(b) BYTE_BITS_4(b), BYTE_BITS_4((b) + 4), BYTE_BITS_4((b) + 8), BYTE_BITS_4((b) + 12)
+#define BYTE_BITS_64(b) BYTE_BITS_16(b), BYTE_BITS_16((b) + 16), BYTE_BITS_16((b) + 32), BYTE_BITS_16((b) + 48)
+static const BitSequence byteToBits[256][BITS_N_BYTE] = {
+	BYTE_BITS_64(0), BYTE_BITS_64(64), BYTE_BITS_64(128), BYTE_BITS_64(192)
+};
+#undef BYTE_BITS_64
+#undef BYTE_BITS_16
+#undef BYTE_BITS_4
+#undef BYTE_BITS
+
+
 /*
  * copyBitsToEpsilon - convert binary bytes into the end of an epsilon bit array
  *
  * given:
  *      x               // pointer to an array (even just 1) binary bytes
  *      xBitLength      // Number of bits to convert
- *      bitsNeeded      // Total number of bits we want to convert this run
  *      num_0s          // pointer to number of 0 bits converted so far
  *      num_1s          // pointer to number of 1 bits converted so far
  *
  * returns:
  *      true ==> we have converted enough bits
  *      false ==> we have NOT converted enough bits, yet
+ *
+ * Bytes are expanded with byteToBits[] and 1 bits are counted with popcount.
  */
 static bool
 copyBitsToEpsilon(BYTE *x, long int xBitLength, long int *num_0s, long int *num_1s)
 {
+	long int bitCount;	// Number of bits to convert in this call
+	long int byteCount;	// Number of whole bytes to convert in this call
+	long int ones;		// Number of 1 bits converted in this call
 	long int i;
 	long int j;
-	long int count;
-	int bit;
-	BYTE mask;
-	long int zeros;
-	long int ones;
-	long int bitsNeeded;
+	BitSequence *dst;	// Where the next converted bit goes
+	WORD64 word;		// 8 bytes of x
+	BYTE last;		// Final partial byte of x
 
 	/*
-	 * Check preconditions (firewall)
+	 * Convert no more bits than are still needed
 	 */
-#if 0	// now a static fixed array
-	if (epsilon == NULL) {
-		err(227, __func__, "epsilon is NULL");
+	bitCount = n - bitsRead;
+	if (xBitLength < bitCount) {
+		bitCount = xBitLength;
 	}
-#endif
-
-	bitsNeeded = n;
+	if (bitCount <= 0) {
+		return (bitsRead >= n);
+	}
+	byteCount = bitCount / BITS_N_BYTE;
+	dst = epsilon + bitsRead;
 
-	count = 0;
-	zeros = ones = 0;
-	for (i = 0; i < (xBitLength + BITS_N_BYTE - 1) / BITS_N_BYTE; i++) {
-		mask = 0x80;
-		for (j = 0; j < 8; j++) {
-			if (*(x + i) & mask) {
-				bit = 1;
-				(*num_1s)++;
-				ones++;
-			} else {
-				bit = 0;
-				(*num_0s)++;
-				zeros++;
-			}
-			mask >>= 1;
-			epsilon[bitsRead] = (BitSequence) bit;
-			(bitsRead)++;
-			if (bitsRead >= bitsNeeded) {
-				return true;
-			}
-			if (++count == xBitLength) {
-				return false;
-			}
+	/*
+	 * Convert 64 bits at a time
+	 */
+	ones = 0;
+	for (i = 0; i + (long int) sizeof(word) <= byteCount; i += (long int) sizeof(word)) {
+		memcpy(&word, x + i, sizeof(word));
+		ones += __builtin_popcountll(word);
+		for (j = 0; j < (long int) sizeof(word); j++) {
+			memcpy(dst, byteToBits[x[i + j]], BITS_N_BYTE);
+			dst += BITS_N_BYTE;
 		}
 	}
 
-	return false;
+	/*
+	 * Convert the remaining whole bytes
+	 */
+	for (; i < byteCount; i++) {
+		ones += __builtin_popcount(x[i]);
+		memcpy(dst, byteToBits[x[i]], BITS_N_BYTE);
+		dst += BITS_N_BYTE;
+	}
+
+	/*
+	 * Convert the leading bits of a final partial byte
+	 */
+	j = bitCount % BITS_N_BYTE;
+	if (j > 0) {
+		last = x[byteCount];
+		ones += __builtin_popcount((unsigned int) last >> (BITS_N_BYTE - j));
+		memcpy(dst, byteToBits[last], (size_t) j);
+	}
+
+	*num_1s += ones;
+	*num_0s += bitCount - ones;
+	bitsRead += bitCount;
+
+	return (bitsRead >= n);
 }
 
 